@@ -2,8 +2,11 @@ set(SJAAK_SRC_FILES
    src/misc/ansi.c
    src/misc/aligned_malloc.c
    src/misc/cfgpath.c
+   src/misc/cpu.c
    src/misc/genrand.c
    src/misc/keypressed.c
+   src/misc/large_malloc.c
+   src/misc/smp.c
    src/misc/snprintf.c
    src/misc/softexp.c
 
@@ -17,6 +20,7 @@ set(SJAAK_SRC_FILES
    src/hash/hashkey.c
    src/hash/hashtable.c
    src/hash/evalhash.c
+   src/hash/perfthash.c
 
    src/timer/timer.c
 )
@@ -17,20 +17,141 @@
 #ifndef BITBOARD_H
 #define BITBOARD_H
 #include <algorithm>
+#include <climits>
 #include <cstring>
+#include <type_traits>
 #include "assert.h"
 #include "bits.h"
 #include "squares.h"
 
+/* Collect the bits of one line (a file or a diagonal) in a 64-bit word into
+ * consecutive bits, using a single multiplication. The bits on a line are
+ * evenly spaced, so they can be shifted into place without the partial
+ * products running into each other. Used to extract lines from boards that
+ * do not fit in 64 bits, one word at a time.
+ */
+struct line_gather_t {
+#if HAVE_UINT128_T
+   typedef uint128_t product_t;  /* Full 64x64 bit product, so no bits are lost */
+#else
+   typedef uint64_t product_t;
+#endif
+   uint64_t mask;
+   uint64_t magic;
+   uint32_t bits;
+   uint8_t shift;
+   uint8_t offset;
+
+   inline uint32_t gather(uint64_t x) const {
+      return ((uint32_t)((product_t)(x & mask) * magic >> shift) & bits) << offset;
+   }
+};
+
+/* Find the multiplier that moves bit p of mask to bit target[p] of the
+ * result. Returns false if no single multiplication does the job.
+ */
+static inline bool initialise_line_gather(line_gather_t *g, uint64_t mask, const int target[64])
+{
+   int low = 64, high = -1;
+   int shift = 0;
+   uint64_t bits;
+
+   memset(g, 0, sizeof *g);
+   if (mask == 0) return true;
+
+   for (bits = mask; bits; bits &= bits-1) {
+      int p = lsb64(bits);
+      low  = std::min(low, target[p]);
+      high = std::max(high, target[p]);
+   }
+   for (bits = mask; bits; bits &= bits-1) {
+      int p = lsb64(bits);
+      shift = std::max(shift, p - (target[p] - low));
+   }
+   if (shift + high - low >= (int)(8*sizeof(line_gather_t::product_t))) return false;
+
+   g->mask   = mask;
+   g->shift  = shift;
+   g->offset = low;
+   g->bits   = (1u << (high - low + 1)) - 1;
+   for (bits = mask; bits; bits &= bits-1) {
+      int p = lsb64(bits);
+      g->magic |= 1ull << (shift + target[p] - low - p);
+   }
+
+   /* Verify all occupancies of the line */
+   uint64_t occ = 0;
+   do {
+      uint32_t expect = 0;
+      for (bits = occ; bits; bits &= bits-1)
+         expect |= 1u << target[lsb64(bits)];
+      if (g->gather(occ) != expect) return false;
+      occ = (occ - mask) & mask;
+   } while (occ);
+
+   return true;
+}
+
+/* Bitboard kind for 8x8 boards: a 64-bit type that is distinct from
+ * uint64_t, so that the bitboards, the move generator and the game are
+ * instantiated separately for it. In that instantiation the board geometry
+ * is a compile-time constant (see bitboard_geometry_t below), which lets the
+ * compiler fold the shifts and masks that depend on it.
+ * This needs a second 64-bit integer type, so it is not available where
+ * long is 32 bits.
+ */
+#if defined FIXED8X8 && ULONG_MAX == 0xffffffffffffffffull
+#define HAVE_FIXED8X8
+typedef std::conditional<std::is_same<uint64_t, unsigned long>::value,
+                         unsigned long long, unsigned long>::type uint64_8x8_t;
+#endif
+
+/* The board geometry. It is set at run time, when a variant is loaded,
+ * except for the fixed 8x8 kind.
+ */
+template<typename kind>
+struct bitboard_geometry_t {
+   static int board_files, board_ranks;
+   static uint32_t rank_mask;
+   static uint32_t file_mask;
+
+   static void set_geometry(int files, int ranks) {
+      board_files = files;
+      board_ranks = ranks;
+      rank_mask = (1<<files)-1;
+      file_mask = (1<<ranks)-1;
+   }
+};
+
+template<typename kind> int bitboard_geometry_t<kind>::board_files;
+template<typename kind> int bitboard_geometry_t<kind>::board_ranks;
+template<typename kind> uint32_t bitboard_geometry_t<kind>::rank_mask;
+template<typename kind> uint32_t bitboard_geometry_t<kind>::file_mask;
+
+#ifdef HAVE_FIXED8X8
+template<>
+struct bitboard_geometry_t<uint64_8x8_t> {
+   static constexpr int board_files = 8, board_ranks = 8;
+   static constexpr uint32_t rank_mask = 0xff;
+   static constexpr uint32_t file_mask = 0xff;
+
+   static void set_geometry(int files, int ranks) {
+      assert(files == board_files && ranks == board_ranks);
+      (void)files; (void)ranks;
+   }
+};
+#endif
+
 template<typename kind>
-class bitboard_t {
+class bitboard_t : public bitboard_geometry_t<kind> {
    public:
       kind bb;
 
    public:
-      static int board_files, board_ranks;
-      static uint32_t rank_mask;
-      static uint32_t file_mask;
+      using bitboard_geometry_t<kind>::board_files;
+      using bitboard_geometry_t<kind>::board_ranks;
+      using bitboard_geometry_t<kind>::rank_mask;
+      using bitboard_geometry_t<kind>::file_mask;
       static uint8_t diagonal_nr[sizeof(kind)*8];
       static uint8_t anti_diagonal_nr[sizeof(kind)*8];
 
@@ -66,18 +187,22 @@ class bitboard_t {
 
       static bitboard_t<kind> board_between[sizeof(kind)*8][sizeof(kind)*8];
 
+      /* Multiply-gathers for files and diagonals, per 64-bit word. Only
+       * used for boards that do not fit in a single word.
+       */
+      static bool have_line_gather;
+      static line_gather_t file_gather[16][2];
+      static line_gather_t diagonal_gather[32][2];
+      static line_gather_t antidiagonal_gather[32][2];
+
       static void initialise_bitboards(int files, int ranks);
+      static void initialise_line_gathers(bool enable = true) { (void)enable; have_line_gather = false; }
 
       bitboard_t() : bb(0) { }
       bitboard_t(const kind &b) : bb(b) { }
 
       kind value() { return bb; }
 
-      bitboard_t<kind> operator = (const bitboard_t<kind>& b) {
-         bb = b.bb;
-         return *this;
-      }
-
       /* Default function definitions, should work with any normal integer
        * type, but can be overridden if a more optimal solution is
        * possible.
@@ -195,17 +320,10 @@ class bitboard_t {
       }
 
       inline uint32_t get_file(int file) const {
-#if 0
-         uint32_t file_bits = 0;
-         int n;
-
-         int bit = file;
-         for (n=0; n<board_ranks; n++) {
-            if (test(bit)) file_bits |= (1<<n);
-            bit += board_files;
-         }
-         return file_bits;
-#else
+         return get_file_fill(file);
+      }
+
+      inline uint32_t get_file_fill(int file) const {
          int shift = 1;
          bitboard_t<kind> b(bb);
          b = (b >> file) & board_file_mask;
@@ -213,11 +331,17 @@ class bitboard_t {
          do {
             b |= (b >> (shift * board_files)) << shift;
             shift <<= 1;
-            //b |= (b >> board_files) << 1;
-            //shift++;
          } while (shift < board_ranks);
          return (uint32_t)(b.bb & file_mask);
-#endif
+      }
+
+      /* Occupancy of a (anti-)diagonal, with bits ordered by file */
+      inline uint32_t get_diagonal(int diag) const {
+         return (*this & board_diagonal[diag]).fill_south().get_rank(0);
+      }
+
+      inline uint32_t get_antidiagonal(int anti) const {
+         return (*this & board_antidiagonal[anti]).fill_south().get_rank(0);
       }
 
       bitboard_t<kind> fill_north() const {
@@ -274,10 +398,6 @@ class bitboard_t {
       }
 };
 
-template<typename kind> int bitboard_t<kind>::board_files;
-template<typename kind> int bitboard_t<kind>::board_ranks;
-template<typename kind> uint32_t bitboard_t<kind>::rank_mask;
-template<typename kind> uint32_t bitboard_t<kind>::file_mask;
 template<typename kind> uint8_t bitboard_t<kind>::diagonal_nr[sizeof(kind)*8];
 template<typename kind> uint8_t bitboard_t<kind>::anti_diagonal_nr[sizeof(kind)*8];
 
@@ -310,17 +430,17 @@ template<typename kind> bitboard_t<kind> bitboard_t<kind>::board_homeland[2];
 template<typename kind> bitboard_t<kind> bitboard_t<kind>::board_diagonal[32];
 template<typename kind> bitboard_t<kind> bitboard_t<kind>::board_antidiagonal[32];
 template<typename kind> bitboard_t<kind> bitboard_t<kind>::board_between[sizeof(kind)*8][sizeof(kind)*8];
+template<typename kind> bool bitboard_t<kind>::have_line_gather;
+template<typename kind> line_gather_t bitboard_t<kind>::file_gather[16][2];
+template<typename kind> line_gather_t bitboard_t<kind>::diagonal_gather[32][2];
+template<typename kind> line_gather_t bitboard_t<kind>::antidiagonal_gather[32][2];
 
 template<typename kind>
 inline void bitboard_t<kind>::initialise_bitboards(int files, int ranks)
 {
-   board_ranks = ranks;
-   board_files = files;
-
    assert(ranks * files <= 8*sizeof(kind));
 
-   rank_mask = (1<<files)-1;
-   file_mask = (1<<ranks)-1;
+   bitboard_geometry_t<kind>::set_geometry(files, ranks);
 
    int size = ranks * files;
    int n;
@@ -491,6 +611,8 @@ inline void bitboard_t<kind>::initialise_bitboards(int files, int ranks)
       }
    }
    board_file_mask = board_file[0];
+
+   initialise_line_gathers();
 }
 
 /* Specialisation for 32 bits: use optimised functions */
@@ -505,6 +627,13 @@ template<> inline int bitboard_t<uint64_t>::bitscan() const { return bitscan64(b
 template<> inline int bitboard_t<uint64_t>::lsb() const { return lsb64(bb); }
 template<> inline int bitboard_t<uint64_t>::msb() const { return msb64(bb); }
 
+#ifdef HAVE_FIXED8X8
+template<> inline int bitboard_t<uint64_8x8_t>::popcount() const { return popcount64(bb); }
+template<> inline int bitboard_t<uint64_8x8_t>::bitscan() const { return bitscan64(bb); }
+template<> inline int bitboard_t<uint64_8x8_t>::lsb() const { return lsb64(bb); }
+template<> inline int bitboard_t<uint64_8x8_t>::msb() const { return msb64(bb); }
+#endif
+
 template<> inline int bitboard_t<uint128_t>::popcount() const { return popcount128(bb); }
 template<> inline int bitboard_t<uint128_t>::bitscan() const { return bitscan128(bb); }
 template<> inline int bitboard_t<uint128_t>::lsb() const { return lsb128(bb); }
@@ -528,18 +657,65 @@ template<> inline uint32_t bitboard_t<uint128_t>::get_rank(int rank) const {
    b = shr128(bb, rank * board_files);
    return b.i64[0] & rank_mask;
 }
-template<> inline uint32_t bitboard_t<uint128_t>::get_file(int file) const {
-   uint32_t file_bits = 0;
-   int n;
+#endif
 
-   int bit = file;
-   for (n=0; n<board_ranks; n++) {
-      if (test(bit)) file_bits |= (1<<n);
-      bit += board_files;
+/* Files and diagonals on boards larger than 64 squares are extracted with
+ * one multiply-gather per 64-bit word, rather than by folding the full
+ * 128-bit board.
+ */
+template<> inline void bitboard_t<uint128_t>::initialise_line_gathers(bool enable)
+{
+   int rank_of[128] = { 0 }, file_of[128] = { 0 };
+   int size = board_files * board_ranks;
+   bool ok = true;
+
+   memset(file_gather, 0, sizeof file_gather);
+   memset(diagonal_gather, 0, sizeof diagonal_gather);
+   memset(antidiagonal_gather, 0, sizeof antidiagonal_gather);
+   have_line_gather = false;
+   if (!enable) return;
+
+   for (int n = 0; n<size; n++) {
+      rank_of[n] = n / board_files;
+      file_of[n] = n % board_files;
+   }
+
+   for (int f = 0; f<board_files; f++) {
+      ok = ok && initialise_line_gather(&file_gather[f][0], lo128((board_file[f] & board_all).bb), rank_of);
+      ok = ok && initialise_line_gather(&file_gather[f][1], hi128((board_file[f] & board_all).bb), rank_of+64);
    }
-   return file_bits;
+
+   for (int d = 0; d<32; d++) {
+      ok = ok && initialise_line_gather(&diagonal_gather[d][0], lo128((board_diagonal[d] & board_all).bb), file_of);
+      ok = ok && initialise_line_gather(&diagonal_gather[d][1], hi128((board_diagonal[d] & board_all).bb), file_of+64);
+      ok = ok && initialise_line_gather(&antidiagonal_gather[d][0], lo128((board_antidiagonal[d] & board_all).bb), file_of);
+      ok = ok && initialise_line_gather(&antidiagonal_gather[d][1], hi128((board_antidiagonal[d] & board_all).bb), file_of+64);
+   }
+
+   have_line_gather = ok;
 }
 
-#endif
+template<> inline uint32_t bitboard_t<uint128_t>::get_file(int file) const {
+   if (!have_line_gather) {
+      uint32_t file_bits = 0;
+      int bit = file;
+      for (int n=0; n<board_ranks; n++) {
+         if (test(bit)) file_bits |= (1<<n);
+         bit += board_files;
+      }
+      return file_bits;
+   }
+   return file_gather[file][0].gather(lo128(bb)) | file_gather[file][1].gather(hi128(bb));
+}
+
+template<> inline uint32_t bitboard_t<uint128_t>::get_diagonal(int diag) const {
+   if (!have_line_gather) return (*this & board_diagonal[diag]).fill_south().get_rank(0);
+   return diagonal_gather[diag][0].gather(lo128(bb)) | diagonal_gather[diag][1].gather(hi128(bb));
+}
+
+template<> inline uint32_t bitboard_t<uint128_t>::get_antidiagonal(int anti) const {
+   if (!have_line_gather) return (*this & board_antidiagonal[anti]).fill_south().get_rank(0);
+   return antidiagonal_gather[anti][0].gather(lo128(bb)) | antidiagonal_gather[anti][1].gather(hi128(bb));
+}
 
 #endif
@@ -106,6 +106,16 @@ static inline bool is_equal128(uint128_t x, uint128_t y)
    return x == y;
 }
 
+static inline uint64_t lo128(uint128_t x)
+{
+   return (uint64_t)x;
+}
+
+static inline uint64_t hi128(uint128_t x)
+{
+   return (uint64_t)(x >> 64);
+}
+
 #else
 #ifdef __cplusplus
 
@@ -278,6 +288,16 @@ static inline bool is_equal128(uint128_t x, uint128_t y)
    return x == y;
 }
 
+static inline uint64_t lo128(uint128_t x)
+{
+   return x.i64[0];
+}
+
+static inline uint64_t hi128(uint128_t x)
+{
+   return x.i64[1];
+}
+
 #else
 
 typedef uint64_t uint128_t __attribute__ ((vector_size(sizeof(uint64_t)*2), aligned(8))); 
@@ -23,6 +23,7 @@
 #include "piece_types.h"
 #include "move.h"
 #include "hashkey.h"
+#include "pst.h"
 #include "squares.h"
 #include "ansi.h"
 
@@ -73,12 +74,26 @@
 #define BF_BSHAK              0x0004      /* Whether a "shak" was given or not */
 #define BF_NO_RETALIATE       0x0008      /* Whether retaliation is allowed or not */
 
+/* Mapping between bits and the squares of the board as the user sees it,
+ * for printing the board. This never changes during the game and is shared
+ * by all copies of a board, so it is kept out of the board itself.
+ */
+struct board_geometry_t {
+   int virtual_files;
+   int virtual_ranks;
+   int bit_to_square[128];
+};
+
 template <typename kind>
 struct unmake_info_t {
    bitboard_t<kind> init;
    bitboard_t<kind> ep;
    uint64_t board_hash;
    uint64_t hash;
+   uint64_t pawn_hash;
+   uint64_t material_hash;
+   eval_pair_t material_score[NUM_SIDES];
+   eval_pair_t pst_score[NUM_SIDES];
    int8_t fifty_counter;
    int8_t check_count[2];
 
@@ -112,6 +127,12 @@ struct board_t {
    /* Hash key */
    uint64_t hash;
    uint64_t board_hash;
+   uint64_t pawn_hash;        /* Only pieces of type piece_types->pawn_index[] */
+   uint64_t material_hash;    /* Number of pieces of each type, on the board and in holdings */
+
+   /* Running material and piece-square sums for the pieces on the board */
+   eval_pair_t material_score[NUM_SIDES];
+   eval_pair_t pst_score[NUM_SIDES];
 
    /* Rule flags, to change the behaviour of the move generator or the evaluation function */
    uint32_t rule_flags;
@@ -134,9 +155,8 @@ struct board_t {
    /* Description of all piece types */
    piece_description_t<kind> *piece_types;
 
-   int virtual_files;
-   int virtual_ranks;
-   int bit_to_square[128];
+   /* Layout of the board, for printing */
+   const board_geometry_t *geometry;
 
    bool check() const { return (board_flags & BF_CHECK); }
    void check(bool chk) {
@@ -171,6 +191,10 @@ struct board_t {
 
       hash = 0;
       board_hash = 0;
+      pawn_hash = 0;
+      material_hash = 0;
+      material_score[WHITE] = material_score[BLACK] = 0;
+      pst_score[WHITE] = pst_score[BLACK] = 0;
 
       board_flags = 0;
 
@@ -192,6 +216,11 @@ struct board_t {
          royal.set(square);
       hash ^= piece_key[type][side][square];
       board_hash ^= piece_key[type][side][square];
+      if (type == piece_types->pawn_index[side])
+         pawn_hash ^= piece_key[type][side][square];
+      material_hash += material_key[type][side];
+      material_score[side] += piece_types->eval_value[type];
+      pst_score[side] += piece_types->eval_pst[type][psq_map[side][square]];
    }
 
    void clear_piece(int type, side_t side, int square)
@@ -205,6 +234,59 @@ struct board_t {
       init.reset(square);
       hash ^= piece_key[type][side][square];
       board_hash ^= piece_key[type][side][square];
+      if (type == piece_types->pawn_index[side])
+         pawn_hash ^= piece_key[type][side][square];
+      material_hash -= material_key[type][side];
+      material_score[side] -= piece_types->eval_value[type];
+      pst_score[side] -= piece_types->eval_pst[type][psq_map[side][square]];
+   }
+
+   /* Recalculate the pawn hash key, needed when pawn_index[] changes */
+   void init_pawn_hash()
+   {
+      pawn_hash = 0;
+      for (side_t side = WHITE; side<NUM_SIDES; side++) {
+         int type = piece_types->pawn_index[side];
+         if (type < 0) continue;
+
+         bitboard_t<kind> bb = bbp[type] & bbc[side];
+         while (!bb.is_empty()) {
+            int square = bb.bitscan();
+            bb.reset(square);
+            pawn_hash ^= piece_key[type][side][square];
+         }
+      }
+   }
+
+   /* Recalculate the material hash key, needed when holdings are set up */
+   void init_material_hash()
+   {
+      material_hash = 0;
+      for (side_t side = WHITE; side<NUM_SIDES; side++)
+      for (int type = 0; type<piece_types->num_piece_types; type++) {
+         material_hash += material_key[type][side] * (bbp[type] & bbc[side]).popcount();
+         material_hash += material_hold_key[type][side] * holdings[type][side];
+      }
+   }
+
+   /* Recalculate the material and piece-square sums, needed when the
+    * evaluation tables change.
+    */
+   void init_eval_scores()
+   {
+      for (side_t side = WHITE; side<NUM_SIDES; side++) {
+         material_score[side] = 0;
+         pst_score[side] = 0;
+         for (int type = 0; type<piece_types->num_piece_types; type++) {
+            bitboard_t<kind> bb = bbp[type] & bbc[side];
+            while (!bb.is_empty()) {
+               int square = bb.bitscan();
+               bb.reset(square);
+               material_score[side] += piece_types->eval_value[type];
+               pst_score[side] += piece_types->eval_pst[type][psq_map[side][square]];
+            }
+         }
+      }
    }
 
    void put_new_piece(int type, side_t side, int square)
@@ -295,7 +377,59 @@ struct board_t {
    }
 
 
-   void makemove(move_t move, unmake_info_t<kind> *ui)
+   /* Calculate the hash key after the move is made, without making it.
+    * This follows makemove() below. Squares that pieces are removed from are
+    * returned in moved, so that the caller can account for castle flags.
+    */
+   uint64_t hash_after_move(move_t move, bitboard_t<kind> *moved = NULL) const
+   {
+      uint64_t key = hash;
+      bitboard_t<kind> from;
+      int n;
+
+      n = get_move_pickups(move);
+      for (int c=0; c<n; c++) {
+         int square  = decode_pickup_square(get_move_pickup(move, c));
+         key ^= piece_key[get_piece(square)][get_side(square)][square];
+         from.set(square);
+      }
+
+      n = get_move_swaps(move);
+      for (int c=0; c<n; c++) {
+         uint16_t p  = get_move_swap(move, c);
+         int square  = decode_swap_from(p);
+         int piece   = get_piece(square);
+         side_t side = get_side(square);
+         key ^= piece_key[piece][side][square] ^ piece_key[piece][side][decode_swap_to(p)];
+         from.set(square);
+      }
+
+      n = get_move_drops(move);
+      for (int c=0; c<n; c++) {
+         uint16_t p = get_move_drop(move, c);
+         key ^= piece_key[decode_drop_piece(p)][decode_drop_side(p)][decode_drop_square(p)];
+      }
+
+      if ((rule_flags & RF_USE_HOLDINGS) && get_move_holdings(move)) {
+         uint16_t p  = get_move_holding(move);
+         int count   = decode_holding_count(p);
+         int piece   = decode_holding_piece(p);
+         side_t side = decode_holding_side(p);
+         if (count < 0)
+            key ^= hold_key[piece][side][holdings[piece][side]];
+         if (count > 0)
+            key ^= hold_key[piece][side][holdings[piece][side] + count];
+      }
+
+      if ((move & MOVE_KEEP_TURN) == 0)
+         key ^= side_to_move_key;
+
+      if (moved) *moved = from;
+      return key;
+   }
+
+   template<bool save_unmake>
+   void do_makemove(move_t move, unmake_info_t<kind> *ui)
    {
       side_t swap_side[3];
       int    swap_piece[3];
@@ -303,18 +437,26 @@ struct board_t {
       int    n;
 
       /* First: backup information for unmake */
-      ui->init = init;
-      ui->hash = hash;
-      ui->board_hash = board_hash;
-      ui->fifty_counter = fifty_counter;
-      ui->ep = ep;
-      ui->ep_victim = ep_victim;
-      ui->board_flags = board_flags;
-      ui->check_count[WHITE] = check_count[WHITE];
-      ui->check_count[BLACK] = check_count[BLACK];
+      if (save_unmake) {
+         ui->init = init;
+         ui->hash = hash;
+         ui->board_hash = board_hash;
+         ui->pawn_hash = pawn_hash;
+         ui->material_hash = material_hash;
+         ui->material_score[WHITE] = material_score[WHITE];
+         ui->material_score[BLACK] = material_score[BLACK];
+         ui->pst_score[WHITE] = pst_score[WHITE];
+         ui->pst_score[BLACK] = pst_score[BLACK];
+         ui->fifty_counter = fifty_counter;
+         ui->ep = ep;
+         ui->ep_victim = ep_victim;
+         ui->board_flags = board_flags;
+         ui->check_count[WHITE] = check_count[WHITE];
+         ui->check_count[BLACK] = check_count[BLACK];
 #ifdef DEBUGMODE
-      ui->move = move;
+         ui->move = move;
 #endif
+      }
       board_flags &= ~BF_NO_RETALIATE;
 
       /* Second: resolve all pickups */
@@ -325,7 +467,7 @@ struct board_t {
          int piece   = get_piece(square);
          side_t side = get_side(square);
 
-         ui->pickup_piece[c] = piece_for_side(piece, side);
+         if (save_unmake) ui->pickup_piece[c] = piece_for_side(piece, side);
          clear_piece(piece, side, square);
          if ((piece_types->piece_flags[piece] & PF_NO_RETALIATE) && side != side_to_move)
             board_flags |= BF_NO_RETALIATE;
@@ -367,6 +509,7 @@ struct board_t {
          if (count < 0)
             hash ^= hold_key[piece][side][holdings[piece][side]];
          holdings[piece][side] += count;
+         material_hash += material_hold_key[piece][side] * count;
          if (count > 0)
             hash ^= hold_key[piece][side][holdings[piece][side]];
       }
@@ -395,6 +538,19 @@ struct board_t {
       check(false);
    }
 
+   void makemove(move_t move, unmake_info_t<kind> *ui)
+   {
+      do_makemove<true>(move, ui);
+   }
+
+   /* Make a move on a board that is thrown away afterwards rather than
+    * unmade, without saving the information for unmakemove().
+    */
+   void makemove(move_t move)
+   {
+      do_makemove<false>(move, NULL);
+   }
+
    void unmakemove(move_t move, unmake_info_t<kind> *ui)
    {
       side_t swap_side[3];
@@ -456,6 +612,12 @@ struct board_t {
       init = ui->init;
       hash = ui->hash;
       board_hash = ui->board_hash;
+      pawn_hash = ui->pawn_hash;
+      material_hash = ui->material_hash;
+      material_score[WHITE] = ui->material_score[WHITE];
+      material_score[BLACK] = ui->material_score[BLACK];
+      pst_score[WHITE] = ui->pst_score[WHITE];
+      pst_score[BLACK] = ui->pst_score[BLACK];
       fifty_counter = ui->fifty_counter;
       ep = ui->ep;
       ep_victim = ui->ep_victim;
@@ -473,6 +635,8 @@ struct board_t {
       bool occupied[256];
       side_t side[256];
       bitboard_t<kind> occ = get_occupied();
+      const int virtual_files = geometry->virtual_files;
+      const int virtual_ranks = geometry->virtual_ranks;
       int c, n;
 
       for (int r=0; r<virtual_ranks; r++) {
@@ -489,7 +653,7 @@ struct board_t {
       for (int r=0; r<bitboard_t<kind>::board_ranks; r++) {
          for (int f=0; f<bitboard_t<kind>::board_files; f++) {
             int bit    = bitboard_t<kind>::pack_rank_file(r, f);
-            int square = bit_to_square[bit];
+            int square = geometry->bit_to_square[bit];
 
             if (square < 0) continue;
 
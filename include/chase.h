@@ -1,11 +1,14 @@
-bitboard_t<kind> get_chased_pieces(int backtrack)
+/* Pieces chased on a given ply of the game: the pieces that the side that
+ * just moved threatens now but did not threaten before the move.
+ * The result only depends on the position on that ply and the one before
+ * it, so it is remembered in chase_stack and only calculated once for each
+ * ply on the current path. The board must be at the given ply.
+ */
+bitboard_t<kind> get_chased_pieces()
 {
    side_t chaser = next_side[board.side_to_move];
    move_t last_move = 0;
 
-   for (int n = 0; n<2*backtrack; n++)
-      takeback();
-
    if (moves_played) last_move = move_list[moves_played-1];
 
    /* 1. Identify threats:
@@ -22,30 +25,6 @@ bitboard_t<kind> get_chased_pieces(int backtrack)
    movelist_t chase_candidates, old_threats;
    movegen.generate_chase_candidates(&chase_candidates, &board, chaser);
 
-   //printf("Threats:\n");
-   //chase_candidates.print();
-
-   /* Filter out old threats */
-   takeback();
-   movegen.generate_chase_candidates(&old_threats, &board, chaser);
-   for (int n=0; n<chase_candidates.num_moves; n++) {
-      move_t chase = chase_candidates.move[n];
-      for (int k = 0; k<old_threats.num_moves; k++) {
-         if (chase == old_threats.move[k]) {
-            chase_candidates.move[n--] = chase_candidates.move[--chase_candidates.num_moves];
-            break;
-         }
-         /* Special case: a piece moved along a ray, preserving a threat */
-         if (last_move && get_move_from(old_threats.move[k]) == get_move_from(last_move)) {
-            if (get_move_to(old_threats.move[k]) == get_move_to(chase)) {
-               chase_candidates.move[n--] = chase_candidates.move[--chase_candidates.num_moves];
-               break;
-            }
-         }
-      }
-   }
-   replaymove();
-
    /* Equal captures are not chase moves if the reverse capture is also
     * possible. It might not be for lame leapers.
     */
@@ -55,7 +34,7 @@ bitboard_t<kind> get_chased_pieces(int backtrack)
       int cap  = get_move_capture_square(move);
 
       if (board.get_piece(from) == board.get_piece(cap)) {
-         move_flag_t flags = board.piece_types->piece_capture_flags[n];
+         move_flag_t flags = board.piece_types->piece_capture_flags[board.get_piece(from)];
 
          if (is_leaper(flags) && is_masked_leaper(flags)) {
             bitboard_t<kind> occ = board.get_occupied();
@@ -78,26 +57,63 @@ bitboard_t<kind> get_chased_pieces(int backtrack)
       }
    }
 
+   /* Filter out old threats */
+   takeback();
+   movegen.generate_chase_candidates(&old_threats, &board, chaser);
+   for (int n=0; n<chase_candidates.num_moves; n++) {
+      move_t chase = chase_candidates.move[n];
+      for (int k = 0; k<old_threats.num_moves; k++) {
+         if (chase == old_threats.move[k]) {
+            chase_candidates.move[n--] = chase_candidates.move[--chase_candidates.num_moves];
+            break;
+         }
+         /* Special case: a piece moved along a ray, preserving a threat */
+         if (last_move && get_move_from(old_threats.move[k]) == get_move_from(last_move)) {
+            if (get_move_to(old_threats.move[k]) == get_move_to(chase)) {
+               chase_candidates.move[n--] = chase_candidates.move[--chase_candidates.num_moves];
+               break;
+            }
+         }
+      }
+   }
+   replaymove();
+
    /* Identify chased pieces */
    bitboard_t<kind> chased;
    for (int n=0; n<chase_candidates.num_moves; n++) {
       chased.set(get_move_to(chase_candidates.move[n]));
    }
 
-   /* Follow chased pieces around as they move */
-   for (int n = 0; n<2*backtrack; n++) {
-      move_t move = move_list[moves_played-1];
-      if ( (n & 1) && chased.test(get_move_from(move)) ) {
-         chased.reset(get_move_from(move));
-         chased.set(get_move_to(move));
-      }
-      replaymove();
+   return chased;
+}
+
+/* Fill in the chased pieces for the plies in [first, last], which should
+ * include the current ply. Plies that are already known are not calculated
+ * again. On return the board is back at the current ply.
+ */
+void update_chase_stack(int first, int last)
+{
+   if (chase_stack_size < max_moves) {
+      chase_stack = (chase_entry_t *)realloc(chase_stack, max_moves * sizeof *chase_stack);
+      memset(chase_stack + chase_stack_size, 0, (max_moves - chase_stack_size) * sizeof *chase_stack);
+      chase_stack_size = max_moves;
    }
 
-   //printf("Chases:\n");
-   //chase_candidates.print();
+   for (int ply = last; ply >= first; ply--) {
+      chase_entry_t *entry = chase_stack + ply;
+      uint64_t hash = (ply == last) ? board.hash : ui[ply].hash;
+      uint64_t prev_hash = ui[ply-1].hash;
 
-   return chased;
+      if (entry->hash == hash && entry->prev_hash == prev_hash) continue;
+
+      while ((int)moves_played > ply) takeback();
+
+      entry->hash      = hash;
+      entry->prev_hash = prev_hash;
+      entry->chased    = get_chased_pieces().bb;
+   }
+
+   while ((int)moves_played < last) replaymove();
 }
 
 /* The result is one of:
@@ -108,10 +124,6 @@ bitboard_t<kind> get_chased_pieces(int backtrack)
 inline chase_state_t test_chase()
 {
    assert(moves_played > 0);
-   /* TODO */
-   int count = count_repetition();
-
-   //printf("Position repeated %d times\n", count);
 
    int backup = 0;
    for (int n=(int)moves_played-2; n>=0; n-=2) {
@@ -122,37 +134,35 @@ inline chase_state_t test_chase()
       if (ui[n].hash == board.hash) break;
    }
 
-   side_t chaser = next_side[board.side_to_move];
-   side_t chasee = board.side_to_move;
-   bitboard_t<kind> chased_pieces[NUM_SIDES];// = board.bbc[board.side_to_move];
+   int last = (int)moves_played;
+   if (backup) update_chase_stack(last - backup + 1, last);
+
+   /* A side chases if some piece of the other side has been chased on each
+    * of its moves since the repeated position. The chased pieces of earlier
+    * plies are followed as they move.
+    */
+   bitboard_t<kind> chased_pieces[NUM_SIDES];
    bool chasing[NUM_SIDES];
 
-   chased_pieces[WHITE] = board.bbc[WHITE];
-   chased_pieces[BLACK] = board.bbc[BLACK];
-   
-   /* Get chased pieces on the current ply */
-   chased_pieces[chasee] = board.bbc[chasee];
-   for (int n = 0; n<backup/2; n++) {
-      bitboard_t<kind> chased = get_chased_pieces(n);
-      chased_pieces[chasee] &= chased;
-   }
-   chasing[chaser] = !chased_pieces[chasee].is_empty();
+   for (side_t side = WHITE; side<NUM_SIDES; side++) {
+      chased_pieces[side] = board.bbc[side];
 
+      for (int ply = last - (side != board.side_to_move); ply > last - backup; ply -= 2) {
+         bitboard_t<kind> chased = chase_stack[ply].chased;
 
-   /* Other side */
-   takeback();
-   chased_pieces[chaser] = board.bbc[chaser];
-   for (int n = 0; n<backup/2; n++) {
-      bitboard_t<kind> chased = get_chased_pieces(n);
-      chased_pieces[chaser] &= chased;
-   }
-   replaymove();
-   move_t move = move_list[moves_played-1];
-   if ( chased_pieces[chaser].test(get_move_from(move)) ) {
-      chased_pieces[chaser].reset(get_move_from(move));
-      chased_pieces[chaser].set(get_move_to(move));
+         for (int n = ply; n<last; n+=2) {
+            move_t move = move_list[n];
+            if (chased.test(get_move_from(move))) {
+               chased.reset(get_move_from(move));
+               chased.set(get_move_to(move));
+            }
+         }
+
+         chased_pieces[side] &= chased;
+      }
+
+      chasing[next_side[side]] = !chased_pieces[side].is_empty();
    }
-   chasing[chasee] = !chased_pieces[chaser].is_empty();
 
    /* If one side is evading check, then it cannot chase */
    if (!(chased_pieces[WHITE] & board.royal).is_empty()) chasing[WHITE] = false;
@@ -175,4 +185,3 @@ inline chase_state_t test_chase()
 
    return LOSE_CHASE;
 }
-
@@ -0,0 +1,33 @@
+/*  Sjaak, a program for playing chess variants
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CPU_H
+#define CPU_H
+
+#include "bool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Run-time detection of optional instruction set extensions */
+extern bool cpu_has_bmi2(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
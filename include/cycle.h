@@ -0,0 +1,170 @@
+/*  Sjaak, a program for playing chess variants
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Detection of upcoming repetitions (cycles), after Marcel van Kervinck's
+ * cuckoo tables: if the side to move can play a reversible move that
+ * brings back an earlier position, the difference between the two hash
+ * keys is the key of that single move. All such move keys are stored in a
+ * cuckoo hash table, so they can be found with two probes.
+ * The table is built from the actual piece types of the variant; only the
+ * position of one piece changes, so the holdings do not matter.
+ */
+
+/* Pack and unpack the entries of the cuckoo table: piece, side and the
+ * two squares the piece moves between.
+ */
+static inline uint32_t encode_cycle_move(int piece, side_t side, int from, int to)
+{
+   return (uint32_t)piece | (uint32_t)side << 8 | (uint32_t)from << 16 | (uint32_t)to << 24;
+}
+
+static inline int cycle_move_piece(uint32_t move) { return move & 0xff; }
+static inline side_t cycle_move_side(uint32_t move) { return side_t((move >> 8) & 0xff); }
+static inline int cycle_move_from(uint32_t move)  { return (move >> 16) & 0xff; }
+static inline int cycle_move_to(uint32_t move)    { return (move >> 24) & 0xff; }
+
+bool insert_cycle_move(uint64_t key, uint32_t move)
+{
+   uint32_t index = key & cycle_mask;
+
+   /* Move entries to their alternative slot until we find an empty one */
+   for (int n = 0; n<100; n++) {
+      std::swap(cycle_key[index], key);
+      std::swap(cycle_move[index], move);
+      if (key == 0) return true;
+
+      index = (index == (key & cycle_mask)) ? ((key >> 32) & cycle_mask) : (key & cycle_mask);
+   }
+
+   return false;
+}
+
+void initialise_cycle_table()
+{
+   if (cycle_key) return;
+
+   int squares = bitboard_t<kind>::board_ranks * bitboard_t<kind>::board_files;
+   int count = 0;
+
+   /* Count the moves, to get the size of the table */
+   for (int piece = 0; piece<pt.num_piece_types; piece++) {
+      if (pt.piece_flags[piece] & PF_NORET) continue;
+      for (side_t side = WHITE; side<NUM_SIDES; side++)
+      for (int from = 0; from<squares; from++) {
+         bitboard_t<kind> bb = movegen.generate_move_bitboard_for_flags(pt.piece_move_flags[piece], from, bitboard_t<kind>::board_empty, side);
+         count += bb.popcount();
+      }
+   }
+
+   int size = 1024;
+   while (size < 4*count) size *= 2;
+
+   /* Moves between the same two squares (in either direction) have the
+    * same key, so store them once. If inserting fails, try again with a
+    * larger table.
+    */
+   bool ok;
+   do {
+      cycle_mask = size - 1;
+      cycle_key  = (uint64_t *)calloc(size, sizeof *cycle_key);
+      cycle_move = (uint32_t *)calloc(size, sizeof *cycle_move);
+      ok = true;
+
+      for (int piece = 0; piece<pt.num_piece_types && ok; piece++) {
+         if (pt.piece_flags[piece] & PF_NORET) continue;
+         for (side_t side = WHITE; side<NUM_SIDES && ok; side++)
+         for (int from = 0; from<squares && ok; from++) {
+            bitboard_t<kind> bb = movegen.generate_move_bitboard_for_flags(pt.piece_move_flags[piece], from, bitboard_t<kind>::board_empty, side);
+            while (!bb.is_empty() && ok) {
+               int to = bb.bitscan();
+               bb.reset(to);
+
+               if (to < from && movegen.generate_move_bitboard_for_flags(pt.piece_move_flags[piece], to, bitboard_t<kind>::board_empty, side).test(from))
+                  continue;
+
+               uint64_t key = piece_key[piece][side][from] ^ piece_key[piece][side][to] ^ side_to_move_key;
+               ok = insert_cycle_move(key, encode_cycle_move(piece, side, from, to));
+            }
+         }
+      }
+
+      if (!ok) {
+         destroy_cycle_table();
+         size *= 2;
+      }
+   } while (!ok);
+}
+
+void destroy_cycle_table()
+{
+   free(cycle_key);
+   free(cycle_move);
+   cycle_key  = NULL;
+   cycle_move = NULL;
+   cycle_mask = 0;
+}
+
+/* Test whether the side to move can repeat an earlier position with one
+ * reversible move. Only positions since the last irreversible move are
+ * considered, and a move that gives check only counts if perpetual check
+ * is scored the same as a repetition.
+ */
+bool upcoming_repetition()
+{
+   if (!cycle_key || moves_played < 3) return false;
+
+   const side_t me = board.side_to_move;
+   const bitboard_t<kind> occ = board.get_occupied();
+
+   if (move_list[moves_played-1] == 0 || is_irreversible_move(move_list[moves_played-1]))
+      return false;
+
+   for (int n=(int)moves_played-3; n>=0; n-=2) {
+      move_t m1 = move_list[n+1];
+      move_t m0 = move_list[n];
+      if (m1 == 0 || m0 == 0 || is_irreversible_move(m1) || is_irreversible_move(m0))
+         return false;
+
+      uint64_t key = board.hash ^ ui[n].hash;
+      uint32_t index = key & cycle_mask;
+      if (cycle_key[index] != key) {
+         index = (key >> 32) & cycle_mask;
+         if (cycle_key[index] != key) continue;
+      }
+
+      uint32_t move = cycle_move[index];
+      int piece = cycle_move_piece(move);
+      int from  = cycle_move_from(move);
+      int to    = cycle_move_to(move);
+      if (cycle_move_side(move) != me) continue;
+
+      /* The stored move can go either way: find where our piece is now */
+      if (occ.test(to)) std::swap(from, to);
+      if (occ.test(to) || !board.bbc[me].test(from) || board.get_piece(from) != piece)
+         continue;
+
+      if (!movegen.generate_move_bitboard_for_flags(pt.piece_move_flags[piece], from, occ, me).test(to))
+         continue;
+
+      if ((ui[n].board_flags & BF_CHECK) && perpetual != rep_score)
+         continue;
+
+      return true;
+   }
+
+   return false;
+}
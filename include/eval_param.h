@@ -91,6 +91,8 @@
 
 #define FUTILITY_DEPTH        3
 
+#define LAZY_EVAL_MARGIN    300        // Lazy evaluation margin on an 8x8 board, scaled with board size
+
 #define PAWN_SCALE_MG         0.8      // Fraction of nominal piece value
 #define LAME_SCALE_MG         0.9      // Fraction of nominal piece value
 #define LAME_SCALE_EG         1.1      // Fraction of nominal piece value
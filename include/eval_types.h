@@ -27,6 +27,7 @@ struct eval_pair_t {
    eval_pair_t () { mg = eg = 0; }
    eval_pair_t (int v) { mg = eg = v; }
    eval_pair_t (int m, int e) { mg = m; eg = e; }
+   eval_pair_t (const eval_pair_t &) = default;
 
 
    inline eval_pair_t operator = (const eval_pair_t p) {
@@ -144,5 +145,26 @@ struct pawn_structure_t {
    eval_t shelter_score[NUM_SIDES][16];
 };
 
+/* Material hash table entries, indexed by the material hash key.
+ * Everything here only depends on the number of pieces of each type.
+ */
+struct material_hash_entry_t {
+   uint64_t lock;
+   bool valid;
+   bool draw;                       /* Neither side can win: insufficient material */
+   bool can_win[NUM_SIDES];         /* Winning chances, except for colour-bound pieces */
+   int8_t colour_bound[NUM_SIDES];  /* Cannot win if this many pieces are bound to one colour (-1: n/a) */
+   uint8_t scale;                   /* Divide material score by this in drawish endings */
+   int phase;                       /* Game phase of the pieces on the board */
+};
+
+/* Pawn hash table entries, indexed by the pawn hash key */
+template <typename kind>
+struct pawn_hash_entry_t {
+   uint64_t lock;
+   bool valid;
+   pawn_structure_t<kind> ps;
+};
+
 
 #endif
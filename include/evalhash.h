@@ -23,6 +23,7 @@ extern "C" {
 
 #include <stdint.h>
 #include "bool.h"
+#include "large_malloc.h"
 
 #undef DEBUG_EVHASH
 
@@ -36,12 +37,18 @@ typedef struct {
 typedef struct {
    eval_hash_t *data;
    size_t number_of_elements;
+   size_t memory_size;
+   large_malloc_backing_t backing;
+   bool interleaved;
+   bool dirty;
 } eval_hash_table_t;
 
 eval_hash_table_t *create_eval_hash_table(size_t nelem);
 void destroy_eval_hash_table(eval_hash_table_t *table);
+void clear_eval_hash_table(eval_hash_table_t *table);
 bool query_eval_table_entry(eval_hash_table_t *table, uint64_t key, int16_t *score);
 void store_eval_hash_entry(eval_hash_table_t *table, uint64_t key, int16_t score);
+void prefetch_evaltable(eval_hash_table_t *table, uint64_t key);
 
 #ifdef __cplusplus
 }
@@ -92,9 +92,135 @@ void game_template_t<kind>::calculate_pawn_structure(pawn_structure_t<kind> *ps)
    ps->weak   = weak;
 }
 
+/* Look up the pawn structure in the pawn hash table, calculate it if it is
+ * not there.
+ */
+template <typename kind>
+const pawn_structure_t<kind> *game_template_t<kind>::probe_pawn_structure(void)
+{
+   pawn_hash_entry_t<kind> *entry = pawn_table + (board.pawn_hash & (PAWN_TABLE_SIZE-1));
+
+   if (!entry->valid || entry->lock != board.pawn_hash) {
+      calculate_pawn_structure(&entry->ps);
+      entry->lock = board.pawn_hash;
+      entry->valid = true;
+   }
+
+   return &entry->ps;
+}
+
+/* Assess the material balance: winning chances, drawish material
+ * combinations and game phase.
+ */
+template <typename kind>
+void game_template_t<kind>::calculate_material(material_hash_entry_t *me)
+{
+   int num_pieces[NUM_SIDES]     = { 0, 0 };
+   int num_royals[NUM_SIDES]     = { 0, 0 };
+   int num_pawns[NUM_SIDES]      = { 0, 0 };
+   int num_def[NUM_SIDES]        = { 0, 0 };
+   int mate_potential[NUM_SIDES] = { 0, 0 };
+   uint32_t piece_ids[NUM_SIDES] = { 0, 0 };
+   bool holdings = false;
+   bool promote = false;
+
+   memset(me, 0, sizeof *me);
+
+   for (side_t side = WHITE; side<NUM_SIDES; side++) {
+      for (int piece=0; piece<pt.num_piece_types; piece++) {
+         int count = (board.bbc[side] & board.bbp[piece]).popcount();
+
+         if (board.holdings[piece][side]) holdings = true;
+         if (count == 0) continue;
+
+         if (!(pt.piece_flags[piece] & PF_ROYAL)) piece_ids[side] |= 1<<piece;
+         if (pt.piece_flags[piece] & PF_ROYAL) num_royals[side] += count;
+         if (pt.defensive_pieces & (1<<piece)) num_def[side] += count;
+         if (pt.pawn_index[side] == piece) num_pawns[side] += count;
+         if (!(pt.piece_flags[piece] & PF_CANTMATE)) mate_potential[side] += count;
+         if (pt.piece_promotion_choice[piece]) promote = true;
+         num_pieces[side] += count;
+         me->phase += pt.phase_weight[piece] * count;
+      }
+   }
+
+   /* Winning chances
+    * TODO: test if pawns can promote to something with mate potential.
+    */
+   for (side_t side = WHITE; side<NUM_SIDES; side++) {
+      me->colour_bound[side] = -1;
+      if (mate_potential[side] >= 1)
+         me->can_win[side] = true;
+      else {
+         int non_pawn_non_royal = num_pieces[side]-num_pawns[side]-num_royals[side] - num_def[side];
+         if (num_pawns[side] >= 1 || non_pawn_non_royal > 2)
+            me->can_win[side] = true;
+
+         if (non_pawn_non_royal == 2 && !me->can_win[side]) {
+            uint32_t p = piece_ids[side];
+            int n1, n2;
+
+            n1 = n2 = bitscan32(p);
+            p ^= 1<<n2;
+            if (pt.pieces_can_win[n1][n2])
+               me->can_win[side] = true;
+            while (p && !me->can_win[side]) {
+               n1 = n2;
+               n2 = bitscan32(p);
+               p ^= 1<<n2;
+               if (pt.pieces_can_win[n1][n2])
+                  me->can_win[side] = true;
+            }
+         }
+
+         /* If we only have colour-bound pieces on the same colour, we
+          * cannot win. Which colour they are on is not a property of the
+          * material, so that test is left to the evaluation.
+          */
+         if (num_pawns[side] == 0)
+            me->colour_bound[side] = non_pawn_non_royal;
+      }
+
+      /* No pawns and no pieces that can give mate - can't win */
+      if ((piece_ids[side] & (pt.shak_pieces | pt.pawn_pieces)) == 0)
+         me->can_win[side] = false;
+   }
+
+   /* Insufficient material: only claim this if nothing can change the
+    * material balance in a way that restores winning chances.
+    */
+   me->draw = !me->can_win[WHITE] && !me->can_win[BLACK] &&
+              !holdings && !promote &&
+              num_royals[WHITE] && num_royals[BLACK];
+
+   /* Draw-ish material combinations */
+   me->scale = 1;
+   if (num_pawns[WHITE] == 0 && num_pawns[BLACK] == 0) {
+      if (mate_potential[WHITE] == mate_potential[BLACK] && mate_potential[WHITE] == 1 && abs(num_pieces[WHITE]-num_pieces[BLACK]) <= 1)
+         me->scale = 4;
+
+      if (num_pieces[WHITE] == num_pieces[BLACK] && num_pieces[WHITE] == 1 && mate_potential[WHITE]+mate_potential[BLACK] == 1)
+         me->scale = 8;
+   }
+}
+
+template <typename kind>
+const material_hash_entry_t *game_template_t<kind>::probe_material(void)
+{
+   material_hash_entry_t *entry = material_table + (board.material_hash & (MATERIAL_TABLE_SIZE-1));
+
+   if (!entry->valid || entry->lock != board.material_hash) {
+      calculate_material(entry);
+      entry->lock = board.material_hash;
+      entry->valid = true;
+   }
+
+   return entry;
+}
+
 template <typename kind>
 template <bool print>
-eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alpha */, int /* beta */)
+eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int alpha, int beta)
 {
    bitboard_t<kind> moves[8*sizeof(kind)];
    bitboard_t<kind> attack[8*sizeof(kind)];
@@ -108,9 +234,9 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
    bitboard_t<kind> occ = board.get_occupied();
    bitboard_t<kind> defence, castle;
    bitboard_t<kind> defatk;
-   pawn_structure_t<kind> ps;
+   const pawn_structure_t<kind> *ps;
+   const material_hash_entry_t *me;
    bool can_win[NUM_SIDES] = { false, false };
-   int mate_potential[NUM_SIDES] = { 0, 0 };
    int num_pieces[NUM_SIDES]     = { 0, 0 };
    int num_royals[NUM_SIDES]     = { 0, 0 };
    int num_pawns[NUM_SIDES]      = { 0, 0 };
@@ -118,7 +244,6 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
    int num_def[NUM_SIDES]        = { 0, 0 };
    int num_light_bound[NUM_SIDES]= { 0, 0 };
    int num_dark_bound[NUM_SIDES] = { 0, 0 };
-   uint32_t piece_ids[NUM_SIDES] = { 0, 0 };
    int square_list[8*sizeof(kind)] = {0}, square_count = 0;
    int king[NUM_SIDES] = { -1, -1 };
    int shelter[2] = {0, 0};
@@ -134,6 +259,10 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
    eval_t tempo = 0;
    int phase = 0;
    bool symmetric = true;
+#ifdef DEBUG_LAZY_EVAL
+   bool lazy_ev_fired = false;
+   eval_t lazy_ev_score = 0;
+#endif
 
    bool have_eval_hash = query_eval_table_entry(eval_table, board.hash, &hash_ev);
 #ifndef DEBUG_EVHASH
@@ -150,7 +279,53 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
       goto exit;
    }
 
-   calculate_pawn_structure(&ps);
+   eval_count++;
+   me = probe_material();
+   phase = me->phase;
+
+   /* Lazy evaluation: if the material balance and piece-square tables put
+    * the score far enough outside the window, the positional terms are
+    * not going to bring it back, so skip them.
+    * Don't trust the estimate if the side that is ahead may not be able to
+    * win.
+    */
+   if (pt.lazy_margin && !print) {
+      eval_pair_t lazy_mat = board.material_score[WHITE] - board.material_score[BLACK];
+      eval_pair_t lazy_psq = board.pst_score[WHITE] - board.pst_score[BLACK];
+
+      if (board.rule_flags & RF_USE_HOLDINGS) {
+         for (int piece=0; piece<pt.num_piece_types; piece++) {
+            int count = board.holdings[piece][WHITE] - board.holdings[piece][BLACK];
+            lazy_mat += pt.eval_value[piece] * count;
+            lazy_psq += PST_HOLDINGS * count;
+         }
+      }
+
+      if (me->scale > 1)
+         lazy_mat /= me->scale;
+
+      eval_t lazy_ev = (lazy_mat + lazy_psq).interpolate(phase, pt.phase_scale);
+      if (check_limit)
+         lazy_ev += -(board.check_count[WHITE] - board.check_count[BLACK])*check_score / (20*check_limit);
+
+      side_t ahead = (lazy_ev > 0) ? WHITE : BLACK;
+      if (me->can_win[ahead] && me->colour_bound[ahead] < 0) {
+         eval_t score = (side_to_move == WHITE) ? lazy_ev : -lazy_ev;
+
+         if (score - pt.lazy_margin >= beta || score + pt.lazy_margin <= alpha) {
+            lazy_eval_count++;
+#ifdef DEBUG_LAZY_EVAL
+            lazy_ev_fired = true;
+            lazy_ev_score = score;
+#else
+            ev = lazy_ev;
+            goto exit;
+#endif
+         }
+      }
+   }
+
+   ps = probe_pawn_structure();
 
    for (side_t side = WHITE; side<NUM_SIDES; side++) {
       int *perm = pt.val_perm;
@@ -210,7 +385,6 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
          }
 
          if (bb.is_empty()) continue;
-         if (!(pt.piece_flags[piece] & PF_ROYAL)) piece_ids[side] |= 1<<piece;
 
          /* Pair bonus */
          if (pt.piece_flags[piece] & PF_PAIRBONUS) {
@@ -231,10 +405,6 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
                defence.set(square);
                num_def[side]++;
             }
-            mat += pt.eval_value[piece];
-
-            psq   += pt.eval_pst[piece][psq_map[side][square]];
-            phase += pt.phase_weight[piece];
 
             num_pieces[side]++;
             if (pt.pawn_index[side] == piece) num_pawns[side]++;
@@ -252,9 +422,6 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
                   num_dark_bound[side]++;
             }
 
-            if (!(pt.piece_flags[piece] & PF_CANTMATE))
-               mate_potential[side]++;
-
             moves[square] = movegen.generate_move_bitboard_for_flags(pt.piece_move_flags[piece], square, occ, side);
 
             /* Collect attack bitmasks
@@ -290,7 +457,7 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
             }
 
             /* Open files */
-            if ((pt.piece_move_flags[piece] & MF_SLIDER_V) && ps.open.test(square)) {
+            if ((pt.piece_move_flags[piece] & MF_SLIDER_V) && ps->open.test(square)) {
                psq.mg += SLIDER_OPENFILE_MG;
                psq.eg += SLIDER_OPENFILE_EG;
             }
@@ -309,6 +476,12 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
       psq = -psq;
    }
 
+   /* Material and piece-square tables for the pieces on the board are
+    * updated incrementally.
+    */
+   mat += board.material_score[WHITE] - board.material_score[BLACK];
+   psq += board.pst_score[WHITE] - board.pst_score[BLACK];
+
    /* Take into account defensive material */
    // FIXME: doing it this way allows the program to drop a piece, which it
    // thinks is "fine" because it still has its defensive pieces.
@@ -317,7 +490,14 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
    //if (mat.mg > 0) mat.mg = std::max(0, mat.mg - def[BLACK].mg/2);
    //if (mat.eg > 0) mat.eg = std::max(0, mat.eg - def[BLACK].eg/2);
 
-   /* Gather data for shelter and assess winning chances. */
+   /* Winning chances, adjusted for colour-bound pieces */
+   for (side_t side = WHITE; side<NUM_SIDES; side++) {
+      can_win[side] = me->can_win[side];
+      if (me->colour_bound[side] == num_light_bound[side] || me->colour_bound[side] == num_dark_bound[side])
+         can_win[side] = false;
+   }
+
+   /* Gather data for shelter and mop-up evaluation. */
    for (side_t side = WHITE; side<NUM_SIDES; side++) {
       side_t oside = next_side[side];
 
@@ -330,7 +510,7 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
          eval_t cscore = 0;
          int f = unpack_file(king[side]);
 
-         score = ps.shelter_score[side][f];  /* 0-8 */
+         score = ps->shelter_score[side][f];  /* 0-8 */
          shelter[side] = 4*score;            /* 0-32 */
 
          for (int c = SHORT; c<NUM_CASTLE_MOVES; c++)
@@ -340,7 +520,7 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
                int square = bb.bitscan();
                int f = unpack_file(square);
                bb.reset(square);
-               cscore = std::max(cscore, ps.shelter_score[side][f]);
+               cscore = std::max(cscore, ps->shelter_score[side][f]);
             }
          }
 
@@ -367,7 +547,7 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
             bitboard_t<kind> king_zone = bitboard_t<kind>::neighbour_board[king[side]];
             eval_t score = 0;
 
-            score = ps.shelter_score[side][f];
+            score = ps->shelter_score[side][f];
             score += 2*(king_zone & board.bbc[side]).popcount();
             score += (king_zone & less_attacks[side][piece]).popcount();
             shelter[side] = std::min(1*score, KS_SHELTER_WEIGHT);
@@ -382,44 +562,6 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
       /* King safety */
       /* TODO */
 
-      /* Winning chances
-       * TODO: test if pawns can promote to something with mate potential.
-       */
-      if (mate_potential[side] >= 1)
-         can_win[side] = true;
-      else {
-         int non_pawn_non_royal = num_pieces[side]-num_pawns[side]-num_royals[side] - num_def[side];
-         if (num_pawns[side] >= 1 || non_pawn_non_royal > 2)
-            can_win[side] = true;
-
-         if (non_pawn_non_royal == 2 && !can_win[side]) {
-            uint32_t p = piece_ids[side];
-            int n1, n2;
-
-            n1 = n2 = bitscan32(p);
-            p ^= 1<<n2;
-            if (pt.pieces_can_win[n1][n2])
-               can_win[side] = true;
-            while (p && !can_win[side]) {
-               n1 = n2;
-               n2 = bitscan32(p);
-               p ^= 1<<n2;
-               if (pt.pieces_can_win[n1][n2])
-                  can_win[side] = true;
-            }
-         }
-
-         /* If we only have colour-bound pieces on the same colour, we
-          * cannot win.
-          */
-         if (non_pawn_non_royal == num_light_bound[side] && num_pawns[side] == 0) can_win[side] = false;
-         if (non_pawn_non_royal == num_dark_bound[side]  && num_pawns[side] == 0) can_win[side] = false;
-      }
-
-      /* No pawns and no pieces that can give mate - can't win */
-      if ((piece_ids[side] & (pt.shak_pieces | pt.pawn_pieces)) == 0)
-         can_win[side] = false;
-
       /* Mop-up evaluation:
        *  - drive the lone king to a corner
        *  - keep the king and the attacking pieces close
@@ -481,13 +623,8 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
    }
 
    /* Draw-ish material combinations */
-   if (num_pawns[WHITE] == 0 && num_pawns[BLACK] == 0) {
-      if (mate_potential[WHITE] == mate_potential[BLACK] && mate_potential[WHITE] == 1 && abs(num_pieces[WHITE]-num_pieces[BLACK]) <= 1)
-         mat /= 4;
-
-      if (num_pieces[WHITE] == num_pieces[BLACK] && num_pieces[WHITE] == 1 && mate_potential[WHITE]+mate_potential[BLACK] == 1)
-         mat /= 8;
-   }
+   if (me->scale > 1)
+      mat /= me->scale;
 
    /* Mobility, piece safety */
    {
@@ -525,7 +662,7 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
             }
 
             /* Attacks on weak pawns */
-            bitboard_t<kind> wpa = attack[square] & ps.weak;
+            bitboard_t<kind> wpa = attack[square] & ps->weak;
             while (!wpa.is_empty()) {
                int square = wpa.bitscan();
                wpa.reset(square);
@@ -551,7 +688,7 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
             if (pt.pawn_pieces & (1<<piece)) {
 
                /* Passed pawns */
-               if (ps.passed.test(square)) {
+               if (ps->passed.test(square)) {
                   /* TODO: distance to promotion square. Properly. */
                   int rank = unpack_rank(square);
                   if (side == BLACK) rank = (bitboard_t<kind>::board_ranks - 1) - rank;
@@ -611,7 +748,7 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
 
             mob.mg += MOB_SCALE * cw * (score - 4);
             if ( pt.royal_pieces & (1 << piece) ) cw = 4;
-            mob.eg += MOB_SCALE * cw * 4 * (control & (ps.weak | ps.passed) & board.bbc[side]).popcount();
+            mob.eg += MOB_SCALE * cw * 4 * (control & (ps->weak | ps->passed) & board.bbc[side]).popcount();
 
 
             /* Piece placement */
@@ -681,7 +818,7 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
          base.mg = WEAK_PAWN_BASE_MG;
          base.eg = WEAK_PAWN_BASE_EG;
 
-         bitboard_t<kind> wp = ps.weak & board.bbc[side];
+         bitboard_t<kind> wp = ps->weak & board.bbc[side];
          while (!wp.is_empty()) {
             int square = wp.bitscan();
             wp.reset(square);
@@ -741,6 +878,17 @@ eval_t game_template_t<kind>::static_evaluation(side_t side_to_move, int /* alph
    if (ev > 0 && !can_win[WHITE]) { symmetric = false; ev = psq.interpolate(phase, pt.phase_scale); }
    if (ev < 0 && !can_win[BLACK]) { symmetric = false; ev = psq.interpolate(phase, pt.phase_scale); }
 
+#ifdef DEBUG_LAZY_EVAL
+   /* The lazy score was out of the window, check that the full score is
+    * also out of the window, on the same side.
+    */
+   if (lazy_ev_fired) {
+      eval_t score = (side_to_move == WHITE) ? ev : -ev;
+      if ((lazy_ev_score >= beta && score < beta) || (lazy_ev_score <= alpha && score > alpha))
+         lazy_eval_errors++;
+   }
+#endif
+
 #ifdef DEBUG_EVHASH
    /* Sanity check: the hashed score should equal the current score.
     * We only ever get here if we're debugging the evaluation hash.
@@ -317,6 +317,10 @@ void setup_fen_position(const char *str, bool skip_castle = false)
    start_move_count = 2*std::max(0, n-1);
    while(*s && (*s != ' ')) s++;
 
+   board.init_pawn_hash();
+   board.init_material_hash();
+   board.init_eval_scores();
+
    repetition_hash_table[board.hash&0xFFFF] = 1;
    board_repetition_hash_table[board.board_hash&0xFFFF] = 1;
 
@@ -339,10 +343,10 @@ const char *make_fen_string(char *buffer = NULL) const
 
    /* First record: board position */
    /* Scan all ranks */
-   for (r = board.virtual_ranks-1; r>=0; r--) {
+   for (r = geometry.virtual_ranks-1; r>=0; r--) {
       int count = 0;
-      for (f = 0; f < board.virtual_files; f++) {
-         int square = f + r*board.virtual_files;
+      for (f = 0; f < geometry.virtual_files; f++) {
+         int square = f + r*geometry.virtual_files;
          int bit    = square_to_bit[square];
 
          if (bit < 0 || bit_to_square[bit] < 0 || !bitboard_t<kind>::board_all.test(bit)) {
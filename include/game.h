@@ -29,11 +29,13 @@
 #include "score.h"
 #include "hashtable.h"
 #include "evalhash.h"
+#include "perfthash.h"
 #include "eval_types.h"
 #include "eval_param.h"
 #include "timer.h"
 #include "pst.h"
 #include "san.h"
+#include "smp.h"
 
 #define MAX_SEARCH_DEPTH 60       /* maximum depth of search tree */
 
@@ -43,13 +45,31 @@
 
 #define HASH_TABLE_SIZE (16*1024*1024)
 
+/* Number of entries in the pawn and material hash tables (power of 2), per thread */
+#define PAWN_TABLE_SIZE (16*1024)
+#define MATERIAL_TABLE_SIZE (4*1024)
+
 #undef USE_HISTORY_HEURISTIC
 
-static bool abort_search;
+static volatile bool abort_search;
 
 enum play_state_t { SEARCH_OK=0, SEARCH_GAME_ENDED, SEARCH_GAME_ENDED_REPEAT, SEARCH_GAME_ENDED_50_MOVE, SEARCH_GAME_ENDED_MATE, SEARCH_GAME_ENDED_STALEMATE, SEARCH_GAME_ENDED_INSUFFICIENT, SEARCH_GAME_ENDED_LOSEBARE, SEARCH_GAME_ENDED_WINBARE, SEARCH_GAME_ENDED_FORFEIT, SEARCH_GAME_ENDED_INADEQUATEMATE, SEARCH_GAME_ENDED_FLAG_CAPTURED, SEARCH_GAME_ENDED_NOPIECES, SEARCH_GAME_ENDED_CHECK_COUNT };
 enum chase_state_t { NO_CHASE=0, DRAW_CHASE, LOSE_CHASE, WIN_CHASE };
 
+/* Throughput of the basic operations of the search, in operations per
+ * second (see "test throughput").
+ */
+struct throughput_t {
+   int positions;       /* Number of test positions */
+   double movegen;      /* Pseudo-legal move generation, per position */
+   double legal;        /* Legality filter, per pseudo-legal move */
+   double makemove;     /* Make and unmake, per move */
+   double copymake;     /* Copy the board and make, per move */
+   double see;          /* Static exchange evaluation, per move */
+   double eval;         /* Static evaluation, per position */
+   double probe;        /* Transposition table probes */
+};
+
 /* Settings */
 enum { MATE_SEARCH_DISABLED=0, MATE_SEARCH_ENABLE_DROP, MATE_SEARCH_ENABLED };
 
@@ -68,7 +88,7 @@ struct game_t {
    virtual void setup_fen_position(const char * /* str */, bool skip_castle = false) { (void)skip_castle; }
    virtual const char *make_fen_string(char *buffer = NULL) const { return buffer; }
    virtual void start_new_game(void) {}
-   virtual void set_transposition_table_size(size_t /* size */) {}
+   virtual void set_transposition_table_size(size_t /* size */, bool force = false) { (void)force; }
    virtual void print_board(FILE * file = stdout) const {(void)file;}
    virtual void print_bitboards() const {}
    virtual void generate_moves(movelist_t * /* movelist */) const {}
@@ -86,6 +106,9 @@ struct game_t {
    virtual move_t move_string_to_move(const char * move_str, const
    movelist_t * external_movelist = NULL) const { (void)move_str,external_movelist; return 0; }
    virtual play_state_t think(int /* max_depth */) { return SEARCH_OK; }
+   virtual uint64_t perft(int /* depth */, int root = 0, bool legal = false) { (void)root; (void)legal; return 0; }
+   virtual void clear_perft_table() {}
+   virtual void measure_throughput(throughput_t * /* tp */, int /* msec */) {}
    virtual bool ponder() { return false; }
    virtual bool analyse() { return false; }
    virtual void write_piece_descriptions(bool xb = false) const { (void)xb; }
@@ -94,6 +117,8 @@ struct game_t {
    virtual void print_pieces(void) const {}
    virtual void print_eval_parameters(FILE * file = stdout) {(void)file;}
    virtual void load_eval_parameters(FILE *f) {(void)f;}
+   virtual slider_backend_t set_slider_backend(slider_backend_t /* backend */) { return SLIDER_TABLES; }
+   virtual slider_backend_t get_slider_backend(void) const { return SLIDER_TABLES; }
    virtual void print_attacker_bitboard(int /* square */) {}
    virtual void print_attack_bitboard(int /* square */) {}
    virtual int  pack_rank_file(int /* rank */, int /* file */) { return 0; }
@@ -189,7 +214,17 @@ struct game_t {
 
    uint64_t branches_pruned;
 
+   /* Evaluation statistics: number of full (not hashed) evaluations and the
+    * number of those that returned early through lazy evaluation.
+    * With DEBUG_LAZY_EVAL the early exit is not taken, instead the lazy
+    * scores that turn out to be inside the window are counted as errors.
+    */
+   uint64_t eval_count;
+   uint64_t lazy_eval_count;
+   uint64_t lazy_eval_errors;
+
    movelist_t *movelist;
+   movelist_t stage_movelist;    /* Scratch space for staged move generation */
 
    /* Data structure for retrieving the principle variation. At each depth,
     * there are two branches for the tree: the principle variation and the
@@ -210,9 +245,28 @@ struct game_t {
    /* Evaluation table */
    eval_hash_table_t *eval_table;
 
+   /* Take over the hash tables of another game, so they can be reused
+    * rather than freed and allocated again.
+    */
+   void take_hash_tables(game_t *other) {
+      hash_table_t *tt = transposition_table;
+      eval_hash_table_t *et = eval_table;
+      transposition_table = other->transposition_table;
+      eval_table = other->eval_table;
+      other->transposition_table = tt;
+      other->eval_table = et;
+   }
+
    /* Hash table for repetition detection */
    int8_t repetition_hash_table[0xFFFF+1];
    int8_t board_repetition_hash_table[0xFFFF+1];
+
+   /* Cuckoo table of reversible moves, for detecting upcoming repetitions
+    * (see cycle.h). Shared with the helper threads.
+    */
+   uint64_t *cycle_key;
+   uint32_t *cycle_move;
+   uint32_t cycle_mask;
    int8_t fifty_limit;
    int8_t fifty_scale_limit;
 
@@ -232,6 +286,7 @@ struct game_t {
    int analyse_undo;
    int analyse_moves_played;
    int option_ms;
+   bool qsearch_hash;         /* Probe and store the transposition table in quiescence search */
 
    unsigned int random_key;
    eval_t random_amplitude;
@@ -250,6 +305,9 @@ struct game_t {
    int bit_to_square[256];
    int top_left;
 
+   /* Board layout, shared by all copies of the board */
+   board_geometry_t geometry;
+
    /* Various function pointers, so we can easily customise things and
     * adjust to different UIs.
     */
@@ -294,6 +352,13 @@ struct game_template_t : public game_t {
 
    movegen_t<kind> movegen;
 
+   /* Node counts for perft, shared by all threads during a perft */
+   perft_hash_table_t *perft_table;
+
+   /* Pawn structure and material hash tables; every thread has its own */
+   pawn_hash_entry_t<kind> *pawn_table;
+   material_hash_entry_t *material_table;
+
    /* Killer moves, storage space requirements must come from the search
     * function.
     */
@@ -338,6 +403,33 @@ struct game_template_t : public game_t {
    int drop_history[NUM_SIDES][MAX_PIECE_TYPES][8*sizeof(kind)];
    int max_drop_history[NUM_SIDES];
 
+   /* Continuation history: indexed by piece type and destination of the
+    * previous move and of the current move (see history.h).
+    */
+   int16_t *cont_history;
+   int cont_history_stride;
+   size_t cont_history_size;
+
+   /* Pieces chased on each ply of the game, for the chase rule (see
+    * chase.h). An entry is valid if the hash keys of the position and the
+    * position before it match.
+    */
+   struct chase_entry_t {
+      uint64_t hash;
+      uint64_t prev_hash;
+      kind chased;
+   } *chase_stack;
+   size_t chase_stack_size;
+
+   /* Helper threads for the parallel search. Each helper has its own copy of
+    * the board and the search tables (killers, history, move lists), but
+    * shares the transposition table and evaluation table with the master.
+    */
+   game_template_t<kind> *helper[MAX_THREADS];
+   int num_helpers;
+   int helper_id;             /* 0 for the master, >0 for helper threads */
+   int helper_max_depth;
+
    void init() {
       movegen = movegen_t<kind>();
       output_iteration = default_iteration_output;
@@ -351,6 +443,16 @@ struct game_template_t : public game_t {
       move_list = NULL;
       move_clock = NULL;
       ui = NULL;
+      start_fen = NULL;
+      name = NULL;
+
+      num_helpers = 0;
+      helper_id = 0;
+      helper_max_depth = 0;
+      perft_table = NULL;
+      eval_count = 0;
+      lazy_eval_count = 0;
+      lazy_eval_errors = 0;
 
       board.flag[WHITE].clear();
       board.flag[BLACK].clear();
@@ -362,7 +464,12 @@ struct game_template_t : public game_t {
 
       board.clear();
       memset(&pt, 0, sizeof(pt));
+      memset(&geometry, 0, sizeof(geometry));
       board.piece_types = &pt;
+      board.geometry = &geometry;
+
+      pawn_table = (pawn_hash_entry_t<kind> *)calloc(PAWN_TABLE_SIZE, sizeof *pawn_table);
+      material_table = (material_hash_entry_t *)calloc(MATERIAL_TABLE_SIZE, sizeof *material_table);
 
       trace = false;
       show_fail_high = false;
@@ -378,6 +485,7 @@ struct game_template_t : public game_t {
       analyse_new = false;
       analyse_undo = 0;
       option_ms = MATE_SEARCH_ENABLE_DROP;
+      qsearch_hash = true;
 
       fifty_limit = 101;
 
@@ -396,6 +504,14 @@ struct game_template_t : public game_t {
       memset(&clock, 0, sizeof clock);
       memset(max_history, 0, sizeof max_history);
       memset(history, 0, sizeof history);
+      cont_history = NULL;
+      cont_history_stride = 0;
+      cont_history_size = 0;
+      cycle_key = NULL;
+      cycle_move = NULL;
+      cycle_mask = 0;
+      chase_stack = NULL;
+      chase_stack_size = 0;
       memset(counter, 0, sizeof counter);
       memset(combo, 0, sizeof combo);
 
@@ -432,6 +548,8 @@ struct game_template_t : public game_t {
    }
 
    ~game_template_t<kind>() {
+      destroy_helpers();
+
       free(move_list);
       free(move_clock);
       free(ui);
@@ -439,6 +557,15 @@ struct game_template_t : public game_t {
       free(start_fen);
       free(name);
 
+      delete[] movelist;
+      free(pawn_table);
+      free(material_table);
+      free(cont_history);
+      free(chase_stack);
+
+      /* Helpers share piece descriptions and hash tables with the master */
+      if (helper_id) return;
+
       for (int n=0; n<pt.num_piece_types; n++) {
          free(pt.piece_name[n]);
          free(pt.piece_abbreviation[n][WHITE]);
@@ -446,10 +573,11 @@ struct game_template_t : public game_t {
          free(pt.demotion_string[n]);
       }
 
-      delete[] movelist;
-
       destroy_hash_table(transposition_table);
       destroy_eval_hash_table(eval_table);
+      destroy_perft_hash_table(perft_table);
+      destroy_cycle_table();
+      movegen.destroy();
    }
 
    void assess_piece_mate_potential(
@@ -1302,6 +1430,16 @@ struct game_template_t : public game_t {
       }
       if (pt.phase_scale < GAME_PHASE_FLOOR) pt.phase_scale = GAME_PHASE_FLOOR;
 
+      /* Margin for lazy evaluation. Mobility terms grow with the size of
+       * the board, so scale the margin with it.
+       * In games where captured pieces can be dropped back on the board,
+       * king safety and tempo easily outweigh the material balance, so
+       * don't use lazy evaluation there.
+       */
+      pt.lazy_margin = eval_t(LAZY_EVAL_MARGIN * files * ranks / 64);
+      if (board.rule_flags & (RF_USE_CAPTURE | RF_ALLOW_PICKUP | RF_GATE_DROPS))
+         pt.lazy_margin = 0;
+
       /* Mobility weights, dependent on piece-type.
        * The shape of the function is based on Senpai.
        */
@@ -1561,14 +1699,14 @@ struct game_template_t : public game_t {
       pt.sort_piece_values();
 
       /* Mapping of squares and bits */
-      board.virtual_files = (virtual_files >= 0) ? virtual_files : files;
-      board.virtual_ranks = (virtual_ranks >= 0) ? virtual_ranks : ranks;
+      geometry.virtual_files = (virtual_files >= 0) ? virtual_files : files;
+      geometry.virtual_ranks = (virtual_ranks >= 0) ? virtual_ranks : ranks;
       for (int n=0; n<128; n++)
-         board.bit_to_square[n] = -1;
+         geometry.bit_to_square[n] = -1;
       for (int n=0; n<256; n++)
          if (square_to_bit[n] >= 0 && square_to_bit[n] < 128) {
             bit_to_square[square_to_bit[n]] = n;
-            board.bit_to_square[square_to_bit[n]] = n;
+            geometry.bit_to_square[square_to_bit[n]] = n;
          }
 
       /* Make sure any gaps in the board are deleted from masks */
@@ -1635,6 +1773,8 @@ struct game_template_t : public game_t {
       }
 
       initialise_piece_evaluation_terms();
+      board.init_pawn_hash();
+      board.init_eval_scores();
 
       /* Game-ending scores */
       if (perpetual == ILLEGAL+1)
@@ -1659,6 +1799,7 @@ struct game_template_t : public game_t {
          fprintf(f, "Value %s % 4d % 4d\n", s, pt.eval_value[id].mg, pt.eval_value[id].eg);
       }
       fprintf(f, "\n");
+      fprintf(f, "LazyMargin %d\n\n", pt.lazy_margin);
 
       for (int n=0; n<pt.num_piece_types; n++) {
          int id = n;
@@ -1728,6 +1869,13 @@ struct game_template_t : public game_t {
          if (!found_variant) continue;
 
          /* What are we trying to read? */
+         if (strstr(line, "LazyMargin") == line) {
+            int margin = 0;
+            sscanf(line + 10, "%d", &margin);
+            pt.lazy_margin = margin;
+            continue;
+         }
+
          if ((s = strstr(line, "Value"))) {
             s += 5;
             while (*s && isspace(*s)) s++;
@@ -1796,6 +1944,7 @@ struct game_template_t : public game_t {
 
       }
 
+      board.init_eval_scores();
    }
 
    int pack_rank_file(int rank, int file) { return bitboard_t<kind>::pack_rank_file(rank, file); }
@@ -1810,6 +1959,20 @@ struct game_template_t : public game_t {
    void generate_moves(movelist_t *movelist) const {
       movegen.generate_moves(movelist, &board, board.side_to_move);
    }
+
+   /* Switch the slider/hopper attack backend, returns the backend that is
+    * actually used (boards that do not fit in 64 bits only have tables).
+    */
+   slider_backend_t set_slider_backend(slider_backend_t backend) {
+      destroy_helpers();
+      movegen.magic.initialise(&movegen, movegen.super_hopper_flags, backend);
+      return movegen.magic.backend;
+   }
+
+   slider_backend_t get_slider_backend(void) const {
+      return movegen.magic.backend;
+   }
+
    void print_attacker_bitboard(int square) { movegen.get_all_attackers(&board, bitboard_t<kind>::board_all, square).print(); }
    void print_attack_bitboard(int square) { 
       bitboard_t<kind> test_squares;
@@ -1914,27 +2077,28 @@ struct game_template_t : public game_t {
    }
 
    void generate_legal_moves(movelist_t *movelist) const {
-      movegen.generate_moves(movelist, &board, board.side_to_move);
-      board_t<kind> board_copy = board;
+      movegen.generate_legal_moves(movelist, &board, board.side_to_move);
+
+      /* Promotions may need to be quiet moves */
+      if (!(board.rule_flags & RF_QUIET_PROMOTION)) return;
 
-      /* Now filter out the illegal moves */
+      board_t<kind> board_copy = board;
       int n = 0;
-      side_t me = board.side_to_move;
       while(n<movelist->num_moves) {
          unmake_info_t<kind> ui;
          move_t move = movelist->move[n];
-         board_copy.makemove(move, &ui);
-         bool illegal = movegen.player_in_check(&board_copy, me);
+         bool illegal = false;
 
-         if ((board.rule_flags & RF_QUIET_PROMOTION) && is_promotion_move(move) ) {
+         if (is_promotion_move(move)) {
+            board_copy.makemove(move, &ui);
             int square = get_move_to(move);
             int p = board_copy.get_piece(square);
             bitboard_t<kind> atk = movegen.generate_move_bitboard_for_flags(pt.piece_capture_flags[p], square, board_copy.get_occupied(), next_side[board_copy.side_to_move]);
             if (!(atk & board_copy.bbc[board_copy.side_to_move]).is_empty()) illegal = true;
             if (movegen.was_checking_move(&board_copy, board_copy.side_to_move, move)) illegal = true;
+            board_copy.unmakemove(move, &ui);
          }
 
-         board_copy.unmakemove(move, &ui);
          if (illegal) {
             movelist->num_moves--;
             movelist->move[n] = movelist->move[movelist->num_moves];
@@ -1967,6 +2131,20 @@ struct game_template_t : public game_t {
 
       setup_fen_position(start_fen);
       memset(see_cache, 0, sizeof(see_cache));
+      for (int n = 0; n<PAWN_TABLE_SIZE; n++)
+         pawn_table[n].valid = false;
+      memset(material_table, 0, MATERIAL_TABLE_SIZE * sizeof *material_table);
+
+      /* The rules may have changed, so helper threads need to be recreated */
+      destroy_helpers();
+
+      /* Keep the hash tables if they have the right size, just clear them */
+      if (hash_table_has_size(transposition_table, hash_size) &&
+          eval_table && eval_table->number_of_elements == hash_size / 16) {
+         clear_hash_table(transposition_table);
+         clear_eval_hash_table(eval_table);
+         return;
+      }
 
       destroy_hash_table(transposition_table);
       destroy_eval_hash_table(eval_table);
@@ -1974,9 +2152,16 @@ struct game_template_t : public game_t {
       eval_table = create_eval_hash_table(hash_size / 16);
    }
 
-   void set_transposition_table_size(size_t size) { 
+   /* Resize the hash tables. They are only reallocated if the size changes,
+    * or if force is set (for instance, because the memory backing changed).
+    */
+   void set_transposition_table_size(size_t size, bool force = false) {
       hash_size = default_hash_size = size;
 
+      if (!force && hash_table_has_size(transposition_table, hash_size) &&
+          eval_table && eval_table->number_of_elements == hash_size / 16)
+         return;
+
       destroy_hash_table(transposition_table);
       destroy_eval_hash_table(eval_table);
 
@@ -2008,17 +2193,41 @@ struct game_template_t : public game_t {
       if (board.rule_flags & RF_USE_CAPTURE)
       board_repetition_hash_table[board.board_hash&0xFFFF]++;
 
-      for (int c = SHORT; c<NUM_CASTLE_MOVES; c++) {
-         bitboard_t<kind> mask = movegen.castle_mask[c][next_side[board.side_to_move]];
-         if ((board.init & mask) != (ui[moves_played-1].init & mask)) {
-            board.hash ^= flag_key[next_side[board.side_to_move]][c];
-            board.board_hash ^= flag_key[next_side[board.side_to_move]][c];
+      /* Update castle flags of either side if the king or rook moved or was
+       * captured.
+       */
+      bitboard_t<kind> changed = board.init ^ ui[moves_played].init;
+      if (!changed.is_empty()) {
+         for (side_t side = WHITE; side<NUM_SIDES; side++)
+         for (int c = SHORT; c<NUM_CASTLE_MOVES; c++) {
+            if (!(changed & movegen.castle_mask[c][side]).is_empty()) {
+               board.hash ^= flag_key[side][c];
+               board.board_hash ^= flag_key[side][c];
+            }
          }
       }
 
       moves_played++;
    }
 
+   /* The hash key after playmove(move), including the castle flags */
+   uint64_t hash_after_move(move_t move) const
+   {
+      bitboard_t<kind> moved;
+      uint64_t key = board.hash_after_move(move, &moved);
+
+      moved &= board.init;
+      if (!moved.is_empty()) {
+         for (side_t side = WHITE; side<NUM_SIDES; side++)
+         for (int c = SHORT; c<NUM_CASTLE_MOVES; c++) {
+            if (!(moved & movegen.castle_mask[c][side]).is_empty())
+               key ^= flag_key[side][c];
+         }
+      }
+
+      return key;
+   }
+
    void replaymove()
    {
       playmove(move_list[moves_played]);
@@ -2038,10 +2247,16 @@ struct game_template_t : public game_t {
 #include "see.h"
 #include "killer.h"
 #include "history.h"
+#include "cycle.h"
 #include "search.h"
+#include "perft.h"
+#include "throughput.h"
 #include "movestring.h"
 
    void calculate_pawn_structure(pawn_structure_t<kind> *ps);
+   const pawn_structure_t<kind> *probe_pawn_structure(void);
+   void calculate_material(material_hash_entry_t *me);
+   const material_hash_entry_t *probe_material(void);
    template <bool print>
    eval_t static_evaluation(side_t side_to_move, int alpha = -LEGALWIN, int beta = LEGALWIN);
 
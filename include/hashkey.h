@@ -27,6 +27,12 @@ extern uint64_t side_to_move_key;
 extern uint64_t flag_key[2][8];
 extern uint64_t en_passant_key[128];
 
+/* Material keys are added (not xor-ed) once for each piece, so the material
+ * hash key only depends on the number of pieces of each type.
+ */
+extern uint64_t material_key[MAX_PIECE_TYPES][2];
+extern uint64_t material_hold_key[MAX_PIECE_TYPES][2];
+
 void initialise_hash_keys(void);
 
 #ifdef __cplusplus
@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 #include "move.h"
+#include "large_malloc.h"
 
 /* Types of entries that may occur in the table (flags) */
 #define HASH_TYPE_EXACT       0x00000001
@@ -29,30 +30,68 @@
 extern "C" {
 #endif
 
+/* Number of entries in a cluster. A cluster fills exactly one cache line, so
+ * a probe only ever touches a single line of memory.
+ */
+#define HASH_BUCKETS       4
+#define HASH_CLUSTER_SIZE  64
+
+/* Moves are stored in compressed form in the table. The full move is
+ * recovered by matching against the list of generated moves.
+ * The move header (which includes the moving piece, see
+ * get_move_piece()) and the destination square are stored as-is, so the
+ * search can generate moves for the right piece only. The remaining bits
+ * of the move are hashed down into what is left.
+ */
+typedef uint32_t hash_move_t;
+
+#define HASH_MOVE_TO_SHIFT    (MOVE_HEADER_SIZE)
+#define HASH_MOVE_FOLD_SHIFT  (HASH_MOVE_TO_SHIFT + MOVE_SQUARE_BITS)
+#define HASH_MOVE_FOLD_BITS   (32 - HASH_MOVE_FOLD_SHIFT)
+
+static inline hash_move_t compress_hash_move(move_t move)
+{
+   hash_move_t header = (hash_move_t)(move & ((1 << MOVE_HEADER_SIZE) - 1));
+   hash_move_t to     = (hash_move_t)get_move_to(move);
+   hash_move_t fold   = (hash_move_t)(((move >> MOVE_HEADER_SIZE) * 0x9E3779B97F4A7C15ull) >> (64 - HASH_MOVE_FOLD_BITS));
+
+   return header | (to << HASH_MOVE_TO_SHIFT) | (fold << HASH_MOVE_FOLD_SHIFT);
+}
+
 /* Entries in the hash table */
 typedef struct {
    uint32_t lock;          /* Store the full key (for position verification) */
-   move_t best_move;       /* The best move returned from the previous search */
+   hash_move_t best_move;  /* The best move returned from the previous search (compressed) */
    int16_t score;          /* The value of this node */
    int16_t depth;          /* The depth to which this position was searched; distance from horizon */
    uint8_t flags;          /* Properties of this entry */
    uint8_t generation;     /* Generation of this entry */
+   uint16_t padding;
 } hash_table_entry_t;
 
 typedef struct {
-   /* We keep two parallel hash tables: a "depth priority" table and an
-    * "always replace" table.
-    */
-   hash_table_entry_t *data;
-   size_t number_of_elements;
+   hash_table_entry_t entry[HASH_BUCKETS];
+} hash_table_cluster_t;
+
+typedef struct {
+   void *memory;
+   size_t memory_size;
+   large_malloc_backing_t backing;
+   bool interleaved;
+   hash_table_cluster_t *data;
+   size_t number_of_elements;    /* Total number of entries */
+   size_t number_of_clusters;
    size_t write_count;
    uint8_t generation;
+   bool dirty;                   /* Set once anything has been stored */
 } hash_table_t;
 
 hash_table_t *create_hash_table(size_t nelem);
 void destroy_hash_table(hash_table_t *table);
+void clear_hash_table(hash_table_t *table);
+bool hash_table_has_size(const hash_table_t *table, size_t nelem);
 void store_table_entry(hash_table_t *table, uint64_t key, int depth,  int score, unsigned int flags, move_t best_move);
-bool retrieve_table(hash_table_t *table, uint64_t key, int *depth, int *score, unsigned int *flags, move_t *best_move);
+bool retrieve_table(hash_table_t *table, uint64_t key, int *depth, int *score, unsigned int *flags, hash_move_t *best_move);
 void prefetch_hashtable(hash_table_t *table, uint64_t key);
 void prepare_hashtable_search(hash_table_t *table);
 int count_unused_table_entries(hash_table_t *table);
@@ -1,6 +1,75 @@
 #define HISTORY_MAX 0x4000
 #define USE_HISTORY_HEURISTIC
 
+/* Maximum number of continuation history entries per thread (2 MB) */
+#define CONT_HISTORY_BITS  20
+#define CONT_HISTORY_SIZE  (1<<CONT_HISTORY_BITS)
+
+/* Update a history score with a bonus (or penalty), using a "gravity"
+ * update: the larger the score already is, the less it changes, so
+ * scores stay within [-HISTORY_MAX, HISTORY_MAX] and old information
+ * decays without having to rescale the whole table.
+ */
+static inline void history_gravity(int *h, int bonus)
+{
+   if (bonus >  HISTORY_MAX) bonus =  HISTORY_MAX;
+   if (bonus < -HISTORY_MAX) bonus = -HISTORY_MAX;
+   *h += bonus - *h * abs(bonus) / HISTORY_MAX;
+}
+
+/* Continuation history, indexed by the piece type and destination of the
+ * previous move and of the current move. The table is allocated when it is
+ * first needed, and only for the piece types and squares in use, but never
+ * holds more than CONT_HISTORY_SIZE entries: for variants with many piece
+ * types or large boards the index is hashed into the table instead.
+ */
+void allocate_continuation_history()
+{
+#ifdef USE_HISTORY_HEURISTIC
+   if (cont_history) return;
+
+   cont_history_stride = pt.num_piece_types * bitboard_t<kind>::board_ranks*bitboard_t<kind>::board_files;
+   cont_history_size = (size_t)cont_history_stride * cont_history_stride;
+   if (cont_history_size > CONT_HISTORY_SIZE) cont_history_size = CONT_HISTORY_SIZE;
+   cont_history = (int16_t *)calloc(cont_history_size, sizeof *cont_history);
+#endif
+}
+
+int16_t *get_continuation_history_entry(move_t prev_move, move_t move) const
+{
+   if (!cont_history || prev_move == 0) return NULL;
+   if (is_pickup_move(prev_move) || is_pickup_move(move)) return NULL;
+
+   int squares = bitboard_t<kind>::board_ranks*bitboard_t<kind>::board_files;
+   int prev = get_move_piece(prev_move) * squares + get_move_to(prev_move);
+   int cur  = get_move_piece(move) * squares + get_move_to(move);
+   uint64_t index = (uint64_t)prev * cont_history_stride + cur;
+   if (expect((size_t)cont_history_stride * cont_history_stride > cont_history_size, false))
+      index = (index * 0x9E3779B97F4A7C15ull) >> (64 - CONT_HISTORY_BITS);
+   return cont_history + index;
+}
+
+int get_continuation_history_score(move_t prev_move, move_t move) const
+{
+#ifdef USE_HISTORY_HEURISTIC
+   int16_t *entry = get_continuation_history_entry(prev_move, move);
+   if (entry) return *entry;
+#endif
+   return 0;
+}
+
+void update_continuation_history(move_t prev_move, move_t move, int score)
+{
+#ifdef USE_HISTORY_HEURISTIC
+   int16_t *entry = get_continuation_history_entry(prev_move, move);
+   if (!entry) return;
+
+   int h = *entry;
+   history_gravity(&h, score);
+   *entry = h;
+#endif
+}
+
 void update_drop_history(move_t move, int score)
 {
 #ifdef USE_HISTORY_HEURISTIC
@@ -10,19 +79,10 @@ void update_drop_history(move_t move, int score)
    int side  = board.side_to_move;
    int to    = get_move_to(move);
 
-   drop_history[side][piece][to] += score;
+   history_gravity(&drop_history[side][piece][to], score);
    history_score = abs(drop_history[side][piece][to]);
    if (history_score > max_drop_history[side])
       max_drop_history[side] = history_score;
-
-   /* Rescale as needed */
-   if (max_drop_history[side] > HISTORY_MAX) {
-      max_drop_history[side] /= 2;
-      for (side = 0; side <= 1; side++)
-         for (piece=0; piece<pt.num_piece_types; piece++)
-            for (to=0; to<bitboard_t<kind>::board_ranks*bitboard_t<kind>::board_files; to++)
-               drop_history[side][piece][to] /= 2;
-   }
 #endif
 }
 
@@ -34,6 +94,9 @@ void update_history(move_t move, int score)
    if (board.check() || is_promotion_move(move) || is_capture_move(move) || is_pickup_move(move) || is_castle_move(move))
       return;
 
+   if (moves_played > 0)
+      update_continuation_history(move_list[moves_played-1], move, score);
+
    if (is_drop_move(move)) {
       update_drop_history(move, score);
       return;
@@ -43,19 +106,10 @@ void update_history(move_t move, int score)
    int side  = board.side_to_move;
    int to    = get_move_to(move);
 
-   history[side][piece][to] += score;
+   history_gravity(&history[side][piece][to], score);
    history_score = abs(history[side][piece][to]);
    if (history_score > max_history[side])
       max_history[side] = history_score;
-
-   /* Rescale as needed */
-   if (max_history[side] > HISTORY_MAX) {
-      max_history[side] /= 2;
-      for (side = 0; side <= 1; side++)
-         for (piece=0; piece<pt.num_piece_types; piece++)
-            for (to=0; to<bitboard_t<kind>::board_ranks*bitboard_t<kind>::board_files; to++)
-               history[side][piece][to] /= 2;
-   }
 #endif
 }
 
@@ -95,22 +149,8 @@ void clear_history()
 
    memset(drop_history, 0, sizeof drop_history);
    max_drop_history[0] = max_drop_history[1] = 0;
-#endif
-}
 
-void scale_history()
-{
-#ifdef USE_HISTORY_HEURISTIC
-   /* Scale down history scores */
-   for (int side = 0; side <= 1; side++) {
-      max_history[side] /= 2;
-      max_drop_history[side] /= 2;
-      for (int piece=0; piece<pt.num_piece_types; piece++)
-         for (int to=0;
-         to<bitboard_t<kind>::board_ranks*bitboard_t<kind>::board_files; to++) {
-            history[side][piece][to] /= 2;
-            drop_history[side][piece][to] /= 2;
-         }
-   }
+   if (cont_history)
+      memset(cont_history, 0, cont_history_size * sizeof *cont_history);
 #endif
 }
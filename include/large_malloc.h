@@ -0,0 +1,56 @@
+/*  Sjaak, a program for playing chess variants
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LARGE_MALLOC_H
+#define LARGE_MALLOC_H
+
+#include <stdlib.h>
+#include "bool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* How a large block of memory is backed */
+typedef enum {
+   LARGE_MALLOC_CALLOC = 0,   /* Plain calloc() */
+   LARGE_MALLOC_MMAP,         /* Anonymous mmap(), normal pages */
+   LARGE_MALLOC_THP,          /* Anonymous mmap(), transparent huge pages (MADV_HUGEPAGE) */
+   LARGE_MALLOC_HUGETLB       /* Anonymous mmap(), explicit huge pages (MAP_HUGETLB) */
+} large_malloc_backing_t;
+
+/* Settings: try explicit huge pages before transparent huge pages, and
+ * interleave pages over all NUMA nodes (rather than first-touch placement).
+ */
+extern bool large_malloc_use_hugetlb;
+extern bool large_malloc_interleave;
+
+/* Allocate a large, zero-initialised block of memory. The block is page
+ * aligned unless it falls back to calloc().
+ * The backing that was used is returned in backing and must be passed to
+ * large_free(); interleaved is set if the pages are spread over NUMA nodes.
+ */
+void *large_malloc(size_t size, large_malloc_backing_t *backing, bool *interleaved);
+void large_free(void *ptr, size_t size, large_malloc_backing_t backing);
+
+const char *large_malloc_backing_name(large_malloc_backing_t backing);
+int get_number_of_numa_nodes(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,343 @@
+/*  Sjaak, a program for playing chess
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MAGIC_H
+#define MAGIC_H
+
+#include <stdint.h>
+#include <string.h>
+#include "assert.h"
+#include "bitboard.h"
+#include "moveflag.h"
+#include "aligned_malloc.h"
+#include "cpu.h"
+
+/* PEXT is available either because we compile for BMI2 directly, or
+ * because the compiler can generate it for a single function, in which
+ * case we only use it after checking that the CPU supports it.
+ */
+#if defined __BMI2__
+#include <immintrin.h>
+#define HAVE_PEXT
+static inline uint64_t pext64(uint64_t x, uint64_t mask) { return _pext_u64(x, mask); }
+#elif (defined __GNUC__ || defined __clang__) && defined __x86_64__
+#include <immintrin.h>
+#define HAVE_PEXT
+__attribute__((target("bmi2"))) static inline uint64_t pext64(uint64_t x, uint64_t mask) { return _pext_u64(x, mask); }
+#endif
+
+/* How slider and hopper attacks are looked up on boards that fit in 64
+ * bits. Larger (and smaller) boards always use the rank/file tables; on
+ * boards larger than 64 squares files and diagonals are extracted with
+ * per-word multiply-gathers, except with SLIDER_TABLES.
+ */
+typedef enum {
+   SLIDER_AUTO = 0,     /* PEXT if compiled for BMI2, magic multiplication otherwise */
+   SLIDER_TABLES,       /* Rank and file tables, diagonals are mapped onto a rank */
+   SLIDER_MAGIC,        /* Magic bitboards */
+   SLIDER_PEXT          /* Magic bitboards, indexed with the BMI2 PEXT instruction */
+} slider_backend_t;
+
+/* Backend used for games that are created from now on */
+extern slider_backend_t slider_backend;
+
+static inline const char *slider_backend_name(slider_backend_t backend)
+{
+   switch (backend) {
+      case SLIDER_AUTO:   return "auto";
+      case SLIDER_TABLES: return "tables";
+      case SLIDER_MAGIC:  return "magic";
+      case SLIDER_PEXT:   return "pext";
+   }
+   return "?";
+}
+
+/* Without BMI2 code generation, PEXT is in a separate function that can't
+ * be inlined, which costs about as much as the multiplication it saves.
+ * So "auto" only picks PEXT if we are compiling for BMI2 anyway.
+ */
+static inline slider_backend_t resolve_slider_backend(slider_backend_t backend)
+{
+#if defined __BMI2__
+   if (backend == SLIDER_AUTO) backend = SLIDER_PEXT;
+#endif
+   if (backend == SLIDER_AUTO) backend = SLIDER_MAGIC;
+#ifdef HAVE_PEXT
+   if (backend == SLIDER_PEXT && !cpu_has_bmi2()) backend = SLIDER_MAGIC;
+#else
+   if (backend == SLIDER_PEXT) backend = SLIDER_MAGIC;
+#endif
+   return backend;
+}
+
+/* Generic version: no magic tables, the move generator falls back to the
+ * rank/file tables.
+ */
+template<typename kind>
+struct slider_magic_t {
+   static const slider_backend_t backend = SLIDER_TABLES;
+   static const bool has_hoppers = false;
+
+   template<typename gen_t>
+   void initialise(const gen_t *, move_flag_t, slider_backend_t) { }
+   void destroy() { }
+
+   bitboard_t<kind> ortho_slider(int, bitboard_t<kind>) const { return bitboard_t<kind>(); }
+   bitboard_t<kind> diag_slider (int, bitboard_t<kind>) const { return bitboard_t<kind>(); }
+   bitboard_t<kind> ortho_hopper(int, bitboard_t<kind>) const { return bitboard_t<kind>(); }
+   bitboard_t<kind> diag_hopper (int, bitboard_t<kind>) const { return bitboard_t<kind>(); }
+};
+
+/* Magic bitboards for 64-bit boards of any geometry.
+ * There is one table for orthogonal (H+V) and one for diagonal (D+A)
+ * lines; pieces that only move along one of the two lines mask the result.
+ * Hoppers use the same index as sliders, since the occupancy of the last
+ * square on a line does not matter for either.
+ * The tables are filled in from the rank/file tables, so both backends
+ * always agree. Used for all kinds of 64-bit bitboards.
+ */
+template<typename kind>
+struct slider_magic64_t {
+   struct entry_t {
+      uint64_t mask;
+      uint64_t magic;
+      int shift;
+      bitboard_t<kind> *slider;
+      bitboard_t<kind> *hopper;
+   };
+
+   slider_backend_t backend;
+   bool has_hoppers;
+   entry_t ortho[64];
+   entry_t diag[64];
+   bitboard_t<kind> *memory;
+
+   inline size_t index(const entry_t &e, uint64_t occ) const {
+#ifdef HAVE_PEXT
+      if (backend == SLIDER_PEXT) return (size_t)pext64(occ, e.mask);
+#endif
+      return (size_t)(((occ & e.mask) * e.magic) >> e.shift);
+   }
+
+   bitboard_t<kind> ortho_slider(int square, bitboard_t<kind> occ) const {
+      return ortho[square].slider[index(ortho[square], occ.bb)];
+   }
+
+   bitboard_t<kind> diag_slider(int square, bitboard_t<kind> occ) const {
+      return diag[square].slider[index(diag[square], occ.bb)];
+   }
+
+   bitboard_t<kind> ortho_hopper(int square, bitboard_t<kind> occ) const {
+      return ortho[square].hopper[index(ortho[square], occ.bb)];
+   }
+
+   bitboard_t<kind> diag_hopper(int square, bitboard_t<kind> occ) const {
+      return diag[square].hopper[index(diag[square], occ.bb)];
+   }
+
+   void destroy() {
+      if (memory) aligned_free(memory);
+      memory = NULL;
+      backend = SLIDER_TABLES;
+      has_hoppers = false;
+   }
+
+   /* Magics found for earlier games, so we don't need to search again when
+    * a game with the same board is set up.
+    */
+   struct magic_cache_t { uint64_t mask, magic; };
+   static magic_cache_t *magic_cache(int type) {
+      static magic_cache_t cache[2][64];
+      return cache[type];
+   }
+
+   static uint64_t magic_random(uint64_t *seed) {
+      /* xorshift64* */
+      *seed ^= *seed >> 12;
+      *seed ^= *seed << 25;
+      *seed ^= *seed >> 27;
+      return *seed * 2685821657736338717ull;
+   }
+
+   /* Find a magic multiplier that maps all occupancies onto distinct
+    * indices, or onto the same index only if the attacks are the same.
+    */
+   static uint64_t find_magic(uint64_t mask, int bits, int count, const uint64_t *occ,
+                              const bitboard_t<kind> *slider, const bitboard_t<kind> *hopper,
+                              bitboard_t<kind> *s_table, bitboard_t<kind> *h_table,
+                              int *epoch, uint64_t cached, uint64_t *seed)
+   {
+      int shift = 64 - bits;
+      size_t size = (size_t)1 << bits;
+      int attempt = 0;
+
+      for (int n = 0; n<(int)size; n++) epoch[n] = 0;
+
+      while (true) {
+         uint64_t magic = cached;
+         cached = 0;
+         if (magic == 0) {
+            magic = magic_random(seed) & magic_random(seed) & magic_random(seed);
+            if (bits >= 8 && popcount64((mask * magic) & 0xFF00000000000000ull) < 6) continue;
+         }
+         attempt++;
+
+         bool ok = true;
+         for (int n = 0; n<count && ok; n++) {
+            size_t idx = (size_t)((occ[n] * magic) >> shift);
+            if (epoch[idx] < attempt) {
+               epoch[idx] = attempt;
+               s_table[idx] = slider[n];
+               h_table[idx] = hopper[n];
+            } else if (s_table[idx] != slider[n] || h_table[idx] != hopper[n]) {
+               ok = false;
+            }
+         }
+         if (ok) return magic;
+      }
+   }
+
+   /* Squares whose occupancy affects attacks along one line type
+    * (0: orthogonal, 1: diagonal) from a square: the lines themselves,
+    * without the square and the edge of the board.
+    */
+   static bitboard_t<kind> line_mask(int type, int square) {
+      int files = bitboard_t<kind>::board_files;
+      int ranks = bitboard_t<kind>::board_ranks;
+      int file = unpack_file(square);
+      int rank = unpack_rank(square);
+      bitboard_t<kind> edge_files = bitboard_t<kind>::board_file[0] | bitboard_t<kind>::board_file[files-1];
+      bitboard_t<kind> edge_ranks = bitboard_t<kind>::board_rank[0] | bitboard_t<kind>::board_rank[ranks-1];
+      bitboard_t<kind> mask;
+
+      if (type == 0) {
+         mask = (bitboard_t<kind>::board_rank[rank] & ~edge_files) |
+                (bitboard_t<kind>::board_file[file] & ~edge_ranks);
+      } else {
+         mask = (bitboard_t<kind>::board_diagonal[bitboard_t<kind>::diagonal_nr[square]] |
+                 bitboard_t<kind>::board_antidiagonal[bitboard_t<kind>::anti_diagonal_nr[square]]) &
+                ~(edge_files | edge_ranks);
+      }
+      mask &= bitboard_t<kind>::board_all;
+      mask.reset(square);
+
+      return mask;
+   }
+
+   /* Size of the tables for one line type */
+   static size_t table_size(int type, bool hoppers) {
+      int size = bitboard_t<kind>::board_files * bitboard_t<kind>::board_ranks;
+      size_t total = 0;
+
+      for (int square = 0; square<size; square++)
+         total += (size_t)(hoppers ? 2 : 1) << line_mask(type, square).popcount();
+
+      return total;
+   }
+
+   /* Set up the tables for one line type */
+   template<typename gen_t>
+   size_t initialise_lines(const gen_t *movegen, int type, bool hoppers, bitboard_t<kind> *table) {
+      move_flag_t flags = type ? (MF_SLIDER_D | MF_SLIDER_A) : (MF_SLIDER_H | MF_SLIDER_V);
+      int size = bitboard_t<kind>::board_files * bitboard_t<kind>::board_ranks;
+      entry_t *entry = type ? diag : ortho;
+      magic_cache_t *cache = magic_cache(type);
+      static uint64_t occ[4096];
+      static bitboard_t<kind> slider[4096], hopper[4096];
+      static bitboard_t<kind> s_table[4096], h_table[4096];
+      static int epoch[4096];
+      uint64_t seed = 0x9E3779B97F4A7C15ull;
+      size_t offset = 0;
+
+      for (int square = 0; square<size; square++) {
+         entry_t &e = entry[square];
+         bitboard_t<kind> mask = line_mask(type, square);
+         int bits = mask.popcount();
+         int count = 0;
+         assert(bits <= 12);
+
+         /* Enumerate all occupancies of the mask, and look up the attacks
+          * in the rank/file tables.
+          */
+         uint64_t o = 0;
+         do {
+            occ[count] = o;
+            slider[count] = movegen->generate_slider_table_bitboard(flags, square, bitboard_t<kind>(o));
+            if (hoppers)
+               hopper[count] = movegen->generate_hopper_table_bitboard(flags << 4, square, bitboard_t<kind>(o));
+            count++;
+            o = (o - mask.bb) & mask.bb;
+         } while (o);
+
+         e.mask = mask.bb;
+         e.shift = 64 - bits;
+         e.magic = 0;
+         e.slider = table + offset;
+         e.hopper = hoppers ? e.slider + ((size_t)1 << bits) : NULL;
+         offset += (size_t)(hoppers ? 2 : 1) << bits;
+
+         if (backend == SLIDER_PEXT) {
+#ifdef HAVE_PEXT
+            for (int n = 0; n<count; n++) {
+               size_t idx = (size_t)pext64(occ[n], e.mask);
+               e.slider[idx] = slider[n];
+               if (hoppers) e.hopper[idx] = hopper[n];
+            }
+#endif
+            continue;
+         }
+
+         uint64_t cached = (cache[square].mask == e.mask) ? cache[square].magic : 0;
+         e.magic = find_magic(e.mask, bits, count, occ, slider, hopper, s_table, h_table, epoch, cached, &seed);
+         cache[square].mask  = e.mask;
+         cache[square].magic = e.magic;
+         memcpy(e.slider, s_table, sizeof(*s_table) << bits);
+         if (hoppers) memcpy(e.hopper, h_table, sizeof(*h_table) << bits);
+      }
+
+      return offset;
+   }
+
+   template<typename gen_t>
+   void initialise(const gen_t *movegen, move_flag_t hopper_flags, slider_backend_t new_backend) {
+      destroy();
+
+      new_backend = resolve_slider_backend(new_backend);
+      if (new_backend == SLIDER_TABLES) return;
+
+      /* Some attack tests use fixed slider moves, so always set up the
+       * slider tables. Hopper tables are only needed if there are hoppers.
+       */
+      has_hoppers = hopper_flags != 0;
+      size_t size = table_size(0, has_hoppers) + table_size(1, has_hoppers);
+
+      memory = (bitboard_t<kind> *)aligned_malloc(size * sizeof *memory, 64);
+      assert(memory);
+      backend = new_backend;
+
+      size_t offset = 0;
+      offset += initialise_lines(movegen, 0, has_hoppers, memory + offset);
+      offset += initialise_lines(movegen, 1, has_hoppers, memory + offset);
+      assert(offset <= size);
+   }
+};
+
+template<> struct slider_magic_t<uint64_t> : slider_magic64_t<uint64_t> { };
+#ifdef HAVE_FIXED8X8
+template<> struct slider_magic_t<uint64_8x8_t> : slider_magic64_t<uint64_8x8_t> { };
+#endif
+
+#endif
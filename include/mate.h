@@ -78,14 +78,19 @@ int msearch(int alpha, int beta, int mply, int depth, int ply = 0)
    /* Test for transposition table cut-offs */
    int hash_depth, hash_score;
    unsigned int hash_flag;
+   hash_move_t tt_move = 0;
    move_t hash_move = 0;
-   bool have_hash = retrieve_table(transposition_table, board.hash, &hash_depth, &hash_score, &hash_flag, &hash_move);
+   bool have_hash = retrieve_table(transposition_table, board.hash, &hash_depth, &hash_score, &hash_flag, &tt_move);
    have_hash = false;
    if (have_hash) {
       hash_score = score_from_hashtable(hash_score, depth);
       bool exact_ok = (depth > 0);
       if (is_mate_score(hash_score)) {
-         if (hash_score > alpha) backup_principle_variation(depth, hash_move);
+         if (hash_score > alpha) {
+            movelist[depth].clear();
+            movegen.generate_moves(&movelist[depth], &board, board.side_to_move, false, pt.deferral_allowed);
+            backup_principle_variation(depth, expand_hash_move(&movelist[depth], tt_move));
+         }
 
          return hash_score;
       }
@@ -114,6 +119,8 @@ int msearch(int alpha, int beta, int mply, int depth, int ply = 0)
    move_t best = 0;
    side_t me = board.side_to_move;
    int legal_moves = 0;
+   legal_filter_t<kind> lf;
+   movegen.prepare_legal_filter(&lf, &board, me, board.check());
    while (stage != STAGE_DONE && (alpha < beta)) {
       stage = movegen.generate_staged_moves(stage, movelist+depth, &board, me);
       legal_moves += movelist[depth].num_moves;
@@ -141,8 +148,13 @@ int msearch(int alpha, int beta, int mply, int depth, int ply = 0)
 
       move_t move;
       while ((move = movelist[depth].next_move())) {
+         move_legality_t legality = movegen.test_move_legality(&lf, &board, move);
+         if (legality == MOVE_ILLEGAL) {
+            legal_moves--;
+            continue;
+         }
          playmove(move);
-         if (player_in_check(me)) {   /* Illegal move */
+         if (legality == MOVE_LEGALITY_UNKNOWN && player_in_check(me)) {   /* Illegal move */
             legal_moves--;
             takeback();
             continue;
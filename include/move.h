@@ -332,6 +332,13 @@ static inline move_t encode_drop_move(uint8_t piece, uint8_t to)
    return encode_number_drops(1) | encode_move_piece(piece) | encode_drop(piece, to) << MOVE_SLOT1 | MOVE_RESET50;
 }
 
+/* Set the square for a drop move that was encoded with square 0 */
+static inline move_t set_drop_square(move_t move, int to)
+{
+   assert(get_move_drops(move) == 1 && decode_drop_square(get_move_drop(move, 0)) == 0);
+   return move | (move_t)to << (MOVE_SLOT1 + DROP_SQUARE_SHIFT);
+}
+
 /* Encode a pickup */
 static inline move_t encode_pickup_move(uint8_t piece, uint8_t to)
 {
@@ -26,16 +26,26 @@
 #include "move.h"
 #include "movelist.h"
 #include "aligned_malloc.h"
+#include "magic.h"
 
 /* Stages for staged move generation */
 typedef enum stage_t { STAGE_START=0,
-                       STAGE_DROP=STAGE_START, STAGE_NORMAL,      /* Normal move generation */
+                       STAGE_HASH=STAGE_START, STAGE_CAPTURES,    /* Normal move generation */
+                       STAGE_KILLERS, STAGE_QUIET, STAGE_DROP,
+                       STAGE_BAD_CAPTURES,
+                       STAGE_ALL,                                 /* All moves at once */
                        STAGE_CHECKING_DROP, STAGE_CHECKING_MOVE,  /* Mate/Tsume search */
                        STAGE_CHECK_EVADE,                         /* Check evasion */
                        STAGE_DONE } stage_t;
 static const stage_t next_stage[STAGE_DONE+1] = {
-   // STAGE_DROP, STAGE_NORMAL,                    /* Normal move generation */
-   STAGE_NORMAL, STAGE_DONE,
+   // STAGE_HASH, STAGE_CAPTURES,                  /* Normal move generation */
+   STAGE_CAPTURES, STAGE_KILLERS,
+   // STAGE_KILLERS, STAGE_QUIET, STAGE_DROP,
+   STAGE_QUIET, STAGE_DROP, STAGE_BAD_CAPTURES,
+   // STAGE_BAD_CAPTURES,
+   STAGE_DONE,
+   // STAGE_ALL,                                   /* All moves at once */
+   STAGE_DONE,
    // STAGE_CHECKING_DROP, STAGE_CHECKING_MOVE,    /* Mate/Tsume search */
    STAGE_CHECKING_MOVE, STAGE_DONE,
    // STAGE_CHECK_EVADE,                           /* Check evasion */
@@ -45,6 +55,27 @@ static const stage_t next_stage[STAGE_DONE+1] = {
    STAGE_DONE
 };
 
+/* Legality of a pseudo-legal move, as far as it can be decided without
+ * playing it.
+ */
+typedef enum move_legality_t { MOVE_LEGAL, MOVE_ILLEGAL, MOVE_LEGALITY_UNKNOWN } move_legality_t;
+
+/* What is needed to decide the legality of moves in a position, see
+ * movegen_t::prepare_legal_filter().
+ */
+template<typename kind>
+struct legal_filter_t {
+   bitboard_t<kind> pinned;      /* Pieces that may only move along their pin ray */
+   bitboard_t<kind> pin_rays;    /* From the king up to and including the pinning pieces */
+   bitboard_t<kind> unsafe;      /* Moves from these squares need to be tested */
+   bitboard_t<kind> screens;     /* Moves to these squares need to be tested */
+   bitboard_t<kind> attacked;    /* Squares the king may not move to */
+   int king;                     /* Square of the royal piece, -1 if there is more than one */
+   bool all_legal;               /* Side to move cannot be in check at all */
+   bool hoppers;                 /* Whether there are hoppers that may attack the king */
+   bool in_check;
+   bool have_attacked;           /* Whether attacked has been calculated yet */
+};
 
 inline stage_t& operator++(stage_t& stage, int)
 {
@@ -55,11 +86,15 @@ inline stage_t& operator++(stage_t& stage, int)
 	return stage;
 }
 
+/* The per-square tables for leapers, riders and steppers are allocated
+ * in initialise() rather than stored in movegen_t itself, so that helper
+ * threads can share them with the master (see create_helper()).
+ */
 template<typename kind>
 struct movegen_t {
    /* Leapers and asymmetric leapers. */
-   bitboard_t<kind> leaper[MAX_LEAPER_TYPES][sizeof(kind)*8];
-   bitboard_t<kind> aleaper[NUM_SIDES][MAX_LEAPER_TYPES][sizeof(kind)*8];
+   bitboard_t<kind> (*leaper)[sizeof(kind)*8];                       /* [MAX_LEAPER_TYPES] */
+   bitboard_t<kind> (*aleaper)[MAX_LEAPER_TYPES][sizeof(kind)*8];    /* [NUM_SIDES] */
    int number_of_leapers;
    int number_of_aleapers;
 
@@ -68,11 +103,21 @@ struct movegen_t {
    struct {
       int dx, dy;
    } rider_step[MAX_RIDER_TYPES][4];
-   bitboard_t<kind> rider_ray[MAX_RIDER_TYPES][sizeof(kind)*8][sizeof(kind)*8];
+   bitboard_t<kind> (*rider_ray)[sizeof(kind)*8][sizeof(kind)*8];   /* [MAX_RIDER_TYPES] */
+
+   /* Rider attack tables: for each distinct direction the full ray from
+    * each square, and the union of all rays. Attacks are found by looking
+    * up the nearest blocker on each ray and removing the part of the ray
+    * beyond it, as for normal sliders.
+    */
+   int rider_num_dirs[MAX_RIDER_TYPES];
+   bool rider_dir_up[MAX_RIDER_TYPES][32];
+   bitboard_t<kind> (*rider_dir_ray)[32][sizeof(kind)*8];           /* [MAX_RIDER_TYPES] */
+   bitboard_t<kind> (*rider_all)[sizeof(kind)*8];                    /* [MAX_RIDER_TYPES] */
 
    /* Stepper descriptions */
    uint32_t stepper_description[MAX_STEPPER_TYPES][NUM_SIDES]; // 8 directions, with repeat counts (0-15) for each->32 bits
-   bitboard_t<kind> stepper_step[MAX_STEPPER_TYPES][NUM_SIDES][sizeof(kind)*8];
+   bitboard_t<kind> (*stepper_step)[NUM_SIDES][sizeof(kind)*8];     /* [MAX_STEPPER_TYPES] */
    bitboard_t<kind> step_mask[8];
    int inverse_step[8];
    int step_shift[8];
@@ -94,6 +139,9 @@ struct movegen_t {
    move_flag_t super_slider_flags;
    move_flag_t super_hopper_flags;
 
+   /* Magic bitboards for slider and hopper moves (64-bit boards only) */
+   slider_magic_t<kind> magic;
+
    /* Super piece */
    bitboard_t<kind> super[sizeof(kind)*8];
    bitboard_t<kind> super_slider[sizeof(kind)*8];
@@ -111,11 +159,25 @@ struct movegen_t {
       super_slider_flags = 0;
       super_hopper_flags = 0;
 
-      memset(leaper, 0, sizeof leaper);
-      memset(aleaper, 0, sizeof aleaper);
+      /* Free tables if previously allocated */
+      destroy();
+
+      leaper        = (bitboard_t<kind> (*)[sizeof(kind)*8])aligned_malloc(MAX_LEAPER_TYPES * sizeof *leaper, 64);
+      aleaper       = (bitboard_t<kind> (*)[MAX_LEAPER_TYPES][sizeof(kind)*8])aligned_malloc(NUM_SIDES * sizeof *aleaper, 64);
+      rider_ray     = (bitboard_t<kind> (*)[sizeof(kind)*8][sizeof(kind)*8])aligned_malloc(MAX_RIDER_TYPES * sizeof *rider_ray, 64);
+      rider_dir_ray = (bitboard_t<kind> (*)[32][sizeof(kind)*8])aligned_malloc(MAX_RIDER_TYPES * sizeof *rider_dir_ray, 64);
+      rider_all     = (bitboard_t<kind> (*)[sizeof(kind)*8])aligned_malloc(MAX_RIDER_TYPES * sizeof *rider_all, 64);
+      stepper_step  = (bitboard_t<kind> (*)[NUM_SIDES][sizeof(kind)*8])aligned_malloc(MAX_STEPPER_TYPES * sizeof *stepper_step, 64);
+      assert(leaper && aleaper && rider_ray && rider_dir_ray && rider_all && stepper_step);
+
+      memset((void *)leaper, 0, MAX_LEAPER_TYPES * sizeof *leaper);
+      memset((void *)aleaper, 0, NUM_SIDES * sizeof *aleaper);
+      memset((void *)rider_ray, 0, MAX_RIDER_TYPES * sizeof *rider_ray);
+      memset((void *)rider_dir_ray, 0, MAX_RIDER_TYPES * sizeof *rider_dir_ray);
+      memset((void *)rider_all, 0, MAX_RIDER_TYPES * sizeof *rider_all);
+      memset((void *)stepper_step, 0, MAX_STEPPER_TYPES * sizeof *stepper_step);
 
       memset(step_mask, 0, sizeof step_mask);
-      memset(stepper_step, 0, sizeof stepper_step);
 
       for (int n = 0; n<NUM_SIDES; n++) {
          castle_mask[SHORT][n].clear();
@@ -130,17 +192,6 @@ struct movegen_t {
          castle_rook_dest[LONG][n].clear();
       }
 
-      /* Free tables if previously allocated */
-      if (horizontal_slider_move) aligned_free(horizontal_slider_move);
-      if (vertical_slider_move)   aligned_free(vertical_slider_move  );
-      if (horizontal_hopper_move) aligned_free(horizontal_hopper_move);
-      if (vertical_hopper_move)   aligned_free(vertical_hopper_move  );
-
-      horizontal_slider_move = NULL;
-      vertical_slider_move   = NULL;
-      horizontal_hopper_move = NULL;
-      vertical_hopper_move   = NULL;
-
       /* Bitshifts for steppers */
       /* Bitshifts for all directions: N   NE  E   SE    S   SW    W   NW */
       step_shift[0] = bitboard_t<kind>::board_files;        // N
@@ -175,6 +226,33 @@ struct movegen_t {
       }
    }
 
+   void destroy() {
+      if (horizontal_slider_move) aligned_free(horizontal_slider_move);
+      if (vertical_slider_move)   aligned_free(vertical_slider_move  );
+      if (horizontal_hopper_move) aligned_free(horizontal_hopper_move);
+      if (vertical_hopper_move)   aligned_free(vertical_hopper_move  );
+      magic.destroy();
+
+      horizontal_slider_move = NULL;
+      vertical_slider_move   = NULL;
+      horizontal_hopper_move = NULL;
+      vertical_hopper_move   = NULL;
+
+      if (leaper)        aligned_free(leaper);
+      if (aleaper)       aligned_free(aleaper);
+      if (rider_ray)     aligned_free(rider_ray);
+      if (rider_dir_ray) aligned_free(rider_dir_ray);
+      if (rider_all)     aligned_free(rider_all);
+      if (stepper_step)  aligned_free(stepper_step);
+
+      leaper        = NULL;
+      aleaper       = NULL;
+      rider_ray     = NULL;
+      rider_dir_ray = NULL;
+      rider_all     = NULL;
+      stepper_step  = NULL;
+   }
+
    void initialise_slider_tables()
    {
       int board_files = bitboard_t<kind>::board_files;
@@ -359,6 +437,10 @@ struct movegen_t {
       int board_size = board_files * board_ranks;
       int n, c;
 
+      /* Now that the board is final, set up the magic tables */
+      magic.initialise(this, super_hopper_flags, slider_backend);
+      bitboard_t<kind>::initialise_line_gathers(slider_backend != SLIDER_TABLES);
+
       /* Initialise stepper masks */
       for (int c = 1; c<number_of_steppers; c++) {
          for(n=0; n<board_size; n++) {
@@ -460,32 +542,21 @@ struct movegen_t {
 
    bitboard_t<kind> generate_rider_move_bitboard(move_flag_t flags, side_t /* side */, int from, bitboard_t<kind> occ) const {
       assert(is_rider(flags));
-      bitboard_t<kind> moves;
       int index = get_rider_index(flags);
 
-      int file = unpack_file(from);
-      int rank = unpack_rank(from);
+      /* Nothing in the way */
+      if ((occ & rider_all[index][from]).is_empty())
+         return rider_all[index][from];
 
-      for (int k=0; k<4; k++) {
-         int sx = rider_step[index][k].dx;
-         int sy = rider_step[index][k].dy;
-
-         if (sx == 0 && sy == 0) break;
-
-         int dx[8] = {  sx,  sx, -sx, -sx,  sy,  sy, -sy, -sy };
-         int dy[8] = {  sy, -sy,  sy, -sy,  sx, -sx,  sx, -sx };
-
-         for (int n = 0; n<8; n++) {
-            int f = file + dx[n];
-            int r = rank + dy[n];
-            while (f>=0 && r>=0 && f<bitboard_t<kind>::board_files && r < bitboard_t<kind>::board_ranks) {
-               int to = bitboard_t<kind>::pack_rank_file(r, f);
-               moves.set(to);
-               f += dx[n];
-               r += dy[n];
-               if (occ.test(to)) break;
-            }
+      bitboard_t<kind> moves;
+      for (int d = 0; d<rider_num_dirs[index]; d++) {
+         bitboard_t<kind> ray = rider_dir_ray[index][d][from];
+         bitboard_t<kind> blockers = ray & occ;
+         if (!blockers.is_empty()) {
+            int square = rider_dir_up[index][d] ? blockers.lsb() : blockers.msb();
+            ray &= ~rider_dir_ray[index][d][square];
          }
+         moves |= ray;
       }
 
       return moves;
@@ -494,6 +565,56 @@ struct movegen_t {
 
    bitboard_t<kind> generate_slider_move_bitboard(move_flag_t flags, side_t /* side */, int square, bitboard_t<kind> occ) const {
       assert(is_slider(flags));
+      if (magic.backend == SLIDER_TABLES)
+         return generate_slider_table_bitboard(flags, square, occ);
+
+      bitboard_t<kind> moves;
+
+      if (flags & (MF_SLIDER_H | MF_SLIDER_V)) {
+         bitboard_t<kind> atk = magic.ortho_slider(square, occ);
+         if (!(flags & MF_SLIDER_H)) atk &= bitboard_t<kind>::board_file[unpack_file(square)];
+         if (!(flags & MF_SLIDER_V)) atk &= bitboard_t<kind>::board_rank[unpack_rank(square)];
+         moves |= atk;
+      }
+
+      if (flags & (MF_SLIDER_D | MF_SLIDER_A)) {
+         bitboard_t<kind> atk = magic.diag_slider(square, occ);
+         if (!(flags & MF_SLIDER_D)) atk &= bitboard_t<kind>::board_antidiagonal[occ.anti_diagonal_nr[square]];
+         if (!(flags & MF_SLIDER_A)) atk &= bitboard_t<kind>::board_diagonal[occ.diagonal_nr[square]];
+         moves |= atk;
+      }
+
+      return moves;
+   }
+
+   bitboard_t<kind> generate_hopper_move_bitboard(move_flag_t flags, side_t /* side */, int square, bitboard_t<kind> occ) const {
+      assert(is_hopper(flags));
+      if (!magic.has_hoppers)
+         return generate_hopper_table_bitboard(flags, square, occ);
+
+      bitboard_t<kind> moves;
+
+      if (flags & (MF_HOPPER_H | MF_HOPPER_V)) {
+         bitboard_t<kind> atk = magic.ortho_hopper(square, occ);
+         if (!(flags & MF_HOPPER_H)) atk &= bitboard_t<kind>::board_file[unpack_file(square)];
+         if (!(flags & MF_HOPPER_V)) atk &= bitboard_t<kind>::board_rank[unpack_rank(square)];
+         moves |= atk;
+      }
+
+      if (flags & (MF_HOPPER_D | MF_HOPPER_A)) {
+         bitboard_t<kind> atk = magic.diag_hopper(square, occ);
+         if (!(flags & MF_HOPPER_D)) atk &= bitboard_t<kind>::board_antidiagonal[occ.anti_diagonal_nr[square]];
+         if (!(flags & MF_HOPPER_A)) atk &= bitboard_t<kind>::board_diagonal[occ.diagonal_nr[square]];
+         moves |= atk;
+      }
+
+      return moves;
+   }
+
+   /* Slider and hopper moves from the rank/file tables. These work for any
+    * board size; diagonals are mapped onto a rank.
+    */
+   bitboard_t<kind> generate_slider_table_bitboard(move_flag_t flags, int square, bitboard_t<kind> occ) const {
       bitboard_t<kind> moves;
       int file = unpack_file(square);
       int rank = unpack_rank(square);
@@ -512,24 +633,19 @@ struct movegen_t {
       }
 
       if (flags & MF_SLIDER_D) {
-         bitboard_t<kind> mask = bitboard_t<kind>::board_diagonal[diag];
-         index = (occ & mask).fill_south().get_rank(0);
-
-         moves |= horizontal_slider_move[file][index] & mask;
+         index = occ.get_diagonal(diag);
+         moves |= horizontal_slider_move[file][index] & bitboard_t<kind>::board_diagonal[diag];
       }
 
       if (flags & MF_SLIDER_A) {
-         bitboard_t<kind> mask = bitboard_t<kind>::board_antidiagonal[anti];
-         index = (occ & mask).fill_south().get_rank(0);
-
-         moves |= horizontal_slider_move[file][index] & mask;
+         index = occ.get_antidiagonal(anti);
+         moves |= horizontal_slider_move[file][index] & bitboard_t<kind>::board_antidiagonal[anti];
       }
 
       return moves;
    }
 
-   bitboard_t<kind> generate_hopper_move_bitboard(move_flag_t flags, side_t /* side */, int square, bitboard_t<kind> occ) const {
-      assert(is_hopper(flags));
+   bitboard_t<kind> generate_hopper_table_bitboard(move_flag_t flags, int square, bitboard_t<kind> occ) const {
       bitboard_t<kind> moves;
       int file = unpack_file(square);
       int rank = unpack_rank(square);
@@ -551,17 +667,13 @@ struct movegen_t {
       }
 
       if (flags & MF_HOPPER_D) {
-         bitboard_t<kind> mask = bitboard_t<kind>::board_diagonal[diag];
-         index = (occ & mask).fill_south().get_rank(0);
-
-         moves |= horizontal_hopper_move[file][index] & mask;
+         index = occ.get_diagonal(diag);
+         moves |= horizontal_hopper_move[file][index] & bitboard_t<kind>::board_diagonal[diag];
       }
 
       if (flags & MF_HOPPER_A) {
-         bitboard_t<kind> mask = bitboard_t<kind>::board_antidiagonal[anti];
-         index = (occ & mask).fill_south().get_rank(0);
-
-         moves |= horizontal_hopper_move[file][index] & mask;
+         index = occ.get_antidiagonal(anti);
+         moves |= horizontal_hopper_move[file][index] & bitboard_t<kind>::board_antidiagonal[anti];
       }
 
       return moves;
@@ -1131,6 +1243,10 @@ struct movegen_t {
          for (int to = 0; to<board_size; to++)
             rider_ray[index][from][to].clear();
 
+      rider_num_dirs[index] = 0;
+      for (int from = 0; from<board_size; from++)
+         rider_all[index][from].clear();
+
       move_flag_t flags = 0;
 
       for (int k=0; s && *s && k<4; k++) {
@@ -1189,6 +1305,38 @@ struct movegen_t {
                }
             }
          }
+
+         /* Attack tables, one entry for each distinct direction */
+         int sx = rider_step[index][k].dx;
+         int sy = rider_step[index][k].dy;
+         int ddx[8] = {  sx,  sx, -sx, -sx,  sy,  sy, -sy, -sy };
+         int ddy[8] = {  sy, -sy,  sy, -sy,  sx, -sx,  sx, -sx };
+         for (int n = 0; n<8; n++) {
+            bool duplicate = false;
+            for (int m = 0; m<n; m++)
+               if (ddx[m] == ddx[n] && ddy[m] == ddy[n]) duplicate = true;
+            for (int kk = 0; kk<k; kk++) {
+               int tx = rider_step[index][kk].dx;
+               int ty = rider_step[index][kk].dy;
+               if ((abs(ddx[n]) == tx && abs(ddy[n]) == ty) || (abs(ddx[n]) == ty && abs(ddy[n]) == tx)) duplicate = true;
+            }
+            if (duplicate) continue;
+
+            int d = rider_num_dirs[index]++;
+            assert(d < 32);
+            rider_dir_up[index][d] = (ddy[n] * w + ddx[n]) > 0;
+            for (int from = 0; from<board_size; from++) {
+               int f = unpack_file(from) + ddx[n];
+               int r = unpack_rank(from) + ddy[n];
+               rider_dir_ray[index][d][from].clear();
+               while (f>=0 && r>=0 && f<w && r<h) {
+                  rider_dir_ray[index][d][from].set(bitboard_t<kind>::pack_rank_file(r, f));
+                  f += ddx[n];
+                  r += ddy[n];
+               }
+               rider_all[index][from] |= rider_dir_ray[index][d][from];
+            }
+         }
       }
 
       return flags;
@@ -1749,7 +1897,13 @@ struct movegen_t {
       return player_in_check(board, side);
    }
 
-   bitboard_t<kind> get_pinned_pieces(const board_t<kind> *board, side_t side) const
+   /* Find the pieces that are pinned against the (single) royal piece.
+    * If pin_rays is given, the squares from the king up to and including
+    * each attacker that pins a piece along a line are added to it. Pieces
+    * that are pinned in other ways (by riders and lame leapers) are also
+    * added to irregular_pins, if it is given.
+    */
+   bitboard_t<kind> get_pinned_pieces(const board_t<kind> *board, side_t side, bitboard_t<kind> *pin_rays = NULL, bitboard_t<kind> *irregular_pins = NULL) const
    {
       bitboard_t<kind> royal = board->royal & board->bbc[side];
       bitboard_t<kind> pinned;
@@ -1766,56 +1920,70 @@ struct movegen_t {
          bitboard_t<kind> atk = board->bbp[n] & board->bbc[next_side[side]] & super[king];
          move_flag_t atk_flags = board->piece_types->piece_capture_flags[n];
 
+         /* Pieces that cannot go to the king's square cannot pin anything */
+         if (!board->piece_types->prison[next_side[side]][n].test(king)) continue;
+
          while(!atk.is_empty()) {
             int attacker = atk.bitscan();
             atk.reset(attacker);
 
             /* Sliders */
             if (is_slider(atk_flags)) {
-               bitboard_t<kind> occ = board->get_occupied();
+               bitboard_t<kind> occ = board->get_occupied() | board->piece_types->block[next_side[side]][n];
                bitboard_t<kind> bb = occ & bitboard_t<kind>::board_between[king][attacker];
                bb &= generate_slider_move_bitboard(atk_flags, next_side[side], attacker, occ & ~bb);
 
-               if (bb.onebit()) pinned |= bb&potential_pins;
+               if (bb.onebit() && !(bb&potential_pins).is_empty()) {
+                  pinned |= bb&potential_pins;
+                  if (pin_rays) *pin_rays |= bitboard_t<kind>::board_between[king][attacker] | bitboard_t<kind>::square_bitboards[attacker];
+               }
             }
 
             /* Hoppers */
             if (is_hopper(atk_flags)) {
-               bitboard_t<kind> occ = board->get_occupied();
+               bitboard_t<kind> occ = board->get_occupied() | board->piece_types->block[next_side[side]][n];
                bitboard_t<kind> bb = occ & bitboard_t<kind>::board_between[king][attacker];
                bb &= generate_slider_move_bitboard(atk_flags>>4, next_side[side], attacker, occ & ~bb);
 
-               if (bb.twobit()) pinned |= bb&potential_pins;
+               if (bb.twobit() && !(bb&potential_pins).is_empty()) {
+                  pinned |= bb&potential_pins;
+                  if (pin_rays) *pin_rays |= bitboard_t<kind>::board_between[king][attacker] | bitboard_t<kind>::square_bitboards[attacker];
+               }
             }
 
             /* Riders */
             if (is_rider(atk_flags)) {
                int index = get_rider_index(atk_flags);
-               bitboard_t<kind> occ = board->get_occupied();
+               bitboard_t<kind> occ = board->get_occupied() | board->piece_types->block[next_side[side]][n];
                bitboard_t<kind> bb = occ & rider_ray[index][king][attacker];
                bb &= generate_rider_move_bitboard(atk_flags>>4, next_side[side], attacker, occ & ~bb);
 
-               if (bb.twobit()) pinned |= bb&potential_pins;
+               if (bb.twobit()) {
+                  pinned |= bb&potential_pins;
+                  if (irregular_pins) *irregular_pins |= bb&potential_pins;
+               }
             }
 
             /* TODO: multi-steppers */
 
             /* Lame leapers */
             if (is_leaper(atk_flags) && is_masked_leaper(atk_flags) && is_double_leaper(atk_flags)) {
-               bitboard_t<kind> occ = board->get_occupied();
+               bitboard_t<kind> occ = board->get_occupied() | board->piece_types->block[next_side[side]][n];
                bitboard_t<kind> atk = generate_leaper_move_bitboard(atk_flags, next_side[side], attacker, occ);
 
                if (!atk.test(king)) {
                   int index = get_leaper_index(atk_flags);
-                  potential_pins &= leaper[index][attacker];
-                  while (!potential_pins.is_empty()) {
-                     int square = potential_pins.bitscan();
-                     potential_pins.reset(square);
-
-                     occ.reset(square);
-                     atk = generate_leaper_move_bitboard(atk_flags, next_side[side], attacker, occ);
+                  bitboard_t<kind> legs = potential_pins & leaper[index][attacker];
+                  while (!legs.is_empty()) {
+                     int square = legs.bitscan();
+                     legs.reset(square);
+
+                     bitboard_t<kind> o = occ;
+                     o.reset(square);
+                     atk = generate_leaper_move_bitboard(atk_flags, next_side[side], attacker, o);
                      if (atk.test(king)) {
                         pinned.set(square);
+                        if (irregular_pins) irregular_pins->set(square);
                         break;
                      }
                   }
@@ -1827,6 +1995,175 @@ struct movegen_t {
       return pinned;
    }
 
+   /* Prepare for testing the legality of moves without making them.
+    * Pieces pinned along a line (by sliders, hoppers or a facing king) may
+    * only move along that line, the king may not move to attacked squares
+    * and a piece moving between a hopper and the king may give it a screen.
+    * Pieces that may uncover an attack in a way that is not tracked here
+    * (lame leapers, riders, multi-steppers) are marked as unsafe.
+    */
+   void prepare_legal_filter(legal_filter_t<kind> *lf, const board_t<kind> *board, side_t side, bool in_check) const
+   {
+      bitboard_t<kind> royal = board->royal & board->bbc[side];
+      side_t oside = next_side[side];
+
+      lf->pinned.clear();
+      lf->pin_rays.clear();
+      lf->unsafe.clear();
+      lf->screens.clear();
+      lf->attacked.clear();
+      lf->king = -1;
+      lf->all_legal = false;
+      lf->hoppers = false;
+      lf->in_check = in_check;
+      lf->have_attacked = false;
+
+      /* See player_in_check(): without royal pieces, or with several that
+       * all have to be attacked, there is never any check.
+       */
+      if (royal.is_empty()) {
+         lf->all_legal = true;
+         return;
+      }
+      if (!royal.onebit()) {
+         lf->all_legal = !(board->rule_flags & (RF_KING_DUPLECHECK|RF_CHECK_ANY_KING));
+         return;
+      }
+
+      int king = royal.bitscan();
+      lf->king = king;
+      if (in_check) return;
+
+      bitboard_t<kind> own = board->bbc[side];
+      bitboard_t<kind> occ = board->get_occupied();
+      bitboard_t<kind> irregular;
+
+      lf->pinned = get_pinned_pieces(board, side, &lf->pin_rays, &irregular);
+      lf->unsafe = irregular;
+
+      /* Kings that may not face each other pin the piece between them */
+      if (board->rule_flags & RF_KING_TABOO) {
+         bitboard_t<kind> bb = board->royal & board->bbc[oside];
+         while (!bb.is_empty()) {
+            int square = bb.bitscan();
+            bb.reset(square);
+            if (unpack_file(square) != unpack_file(king)) continue;
+
+            bitboard_t<kind> between = bitboard_t<kind>::board_between[king][square];
+            if ((occ & between).onebit()) {
+               lf->pinned   |= occ & between & own;
+               lf->pin_rays |= between | bitboard_t<kind>::square_bitboards[square];
+            }
+         }
+      }
+
+      for (int n = 0; n<board->piece_types->num_piece_types; n++) {
+         bitboard_t<kind> atk = board->bbp[n] & board->bbc[oside] & super[king];
+         move_flag_t atk_flags = board->piece_types->piece_capture_flags[n];
+
+         if (atk.is_empty()) continue;
+
+         /* A single piece between a hopper and the king is a screen */
+         if (is_hopper(atk_flags)) {
+            bitboard_t<kind> bb = atk;
+            lf->hoppers = true;
+            while (!bb.is_empty()) {
+               int square = bb.bitscan();
+               bb.reset(square);
+
+               bitboard_t<kind> between = bitboard_t<kind>::board_between[king][square];
+               if ((occ & between).is_empty()) lf->screens |= between;
+            }
+         }
+
+         if (is_rider(atk_flags)) {
+            int index = get_rider_index(atk_flags);
+            bitboard_t<kind> bb = atk;
+            while (!bb.is_empty()) {
+               int square = bb.bitscan();
+               bb.reset(square);
+               lf->unsafe |= own & rider_ray[index][king][square];
+            }
+         }
+
+         if (is_stepper(atk_flags)) {
+            int si = get_stepper_index(atk_flags);
+            for (int d=0; d<8; d++)
+               if (((stepper_description[si][oside] >> (d*4)) & 15) > 1)
+                  lf->unsafe |= own & super_stepper[king];
+         }
+      }
+   }
+
+   move_legality_t test_move_legality(legal_filter_t<kind> *lf, const board_t<kind> *board, move_t move) const
+   {
+      if (lf->all_legal) return MOVE_LEGAL;
+      if (lf->king < 0) return MOVE_LEGALITY_UNKNOWN;
+
+      /* A drop can only uncover an attack by acting as a screen */
+      if (is_drop_move(move)) {
+         if (lf->in_check || lf->screens.test(get_move_to(move))) return MOVE_LEGALITY_UNKNOWN;
+         return MOVE_LEGAL;
+      }
+
+      /* Only plain moves, captures and promotions are considered, not
+       * castling, en-passant, gating or multiple captures.
+       */
+      int pickups = get_move_pickups(move);
+      int drops   = get_move_drops(move);
+      int swaps   = get_move_swaps(move);
+      if (!(swaps == 1 && drops == 0 && pickups <= 1) && !(swaps == 0 && drops == 1 && (pickups == 1 || pickups == 2)))
+         return MOVE_LEGALITY_UNKNOWN;
+
+      int from = get_move_from(move);
+      int to   = get_move_to(move);
+      if (is_capture_move(move)) {
+         if (get_move_capture_square(move) != to) return MOVE_LEGALITY_UNKNOWN;
+         if (board->rule_flags & RF_VICTIM_SIDEEFFECT) return MOVE_LEGALITY_UNKNOWN;
+      }
+      if (is_promotion_move(move) && (board->piece_types->royal_pieces & (1 << get_move_promotion_piece(move))))
+         return MOVE_LEGALITY_UNKNOWN;
+
+      /* King moves */
+      if (from == lf->king) {
+         if (!lf->have_attacked) {
+            side_t oside = next_side[board->side_to_move];
+            bitboard_t<kind> king_bb = bitboard_t<kind>::square_bitboards[from];
+
+            lf->attacked = generate_attack_bitboard_mask(board, bitboard_t<kind>::board_empty, bitboard_t<kind>::board_all, ~king_bb, oside);
+            if (board->rule_flags & RF_KING_TABOO) {
+               bitboard_t<kind> bb = board->royal & board->bbc[oside];
+               while (!bb.is_empty()) {
+                  int square = bb.bitscan();
+                  bb.reset(square);
+                  lf->attacked |= generate_slider_move_bitboard(MF_SLIDER_V, oside, square, board->get_occupied() & ~king_bb);
+               }
+            }
+            lf->have_attacked = true;
+         }
+         return lf->attacked.test(to) ? MOVE_ILLEGAL : MOVE_LEGAL;
+      }
+
+      if (lf->in_check) return MOVE_LEGALITY_UNKNOWN;
+      if (lf->unsafe.test(from) || lf->screens.test(to)) return MOVE_LEGALITY_UNKNOWN;
+
+      /* Pinned pieces must stay on the same side of the king, between it
+       * and the pinning piece (or capture that). With hoppers around,
+       * capturing a piece on the ray may take away a screen.
+       */
+      if (lf->pinned.test(from)) {
+         if (to == from) return MOVE_LEGAL;
+         if (lf->hoppers && is_capture_move(move)) return MOVE_LEGALITY_UNKNOWN;
+         if (lf->pin_rays.test(to) &&
+             (bitboard_t<kind>::board_between[lf->king][to].test(from) ||
+              bitboard_t<kind>::board_between[lf->king][from].test(to)))
+            return MOVE_LEGAL;
+         return MOVE_ILLEGAL;
+      }
+
+      return MOVE_LEGAL;
+   }
+
 
    template<bool special>
    void generate_stepper_moves_mask_for_piece(movelist_t *movelist, const board_t<kind> *board,
@@ -2186,33 +2523,38 @@ struct movegen_t {
       own_movers = own & source_mask;
       bitboard_t<kind> movers = own_movers;
 
-      /* Generate drops */
+      /* Generate drops. The target squares for each piece type are found
+       * as a single bitboard, the moves only differ in the drop square.
+       */
       if (generate_drops && allowed_drop_pieces) {
          bool dropped = false;
+         bitboard_t<kind> empty = destination_mask & ~board->get_occupied();
          for (n=0; n<piece_types->num_piece_types; n++) {
-            bitboard_t<kind> occupied = board->get_occupied();
-
             if (board->holdings[n][side_to_move] && (allowed_drop_pieces & (1 << n))) {
                dropped = true;
 
                int piece = piece_for_side(n, side_to_move);
-               bitboard_t<kind> drops = destination_mask & ~occupied & piece_types->drop_zone[side_to_move][n];
+               bitboard_t<kind> drops = empty & piece_types->drop_zone[side_to_move][n];
 
                if (piece_types->piece_flags[n] & PF_DROPONEFILE) {
-                  for (int f = 0; f<bitboard_t<kind>::board_files; f++) {
-                     bitboard_t<kind> bb = own & board->bbp[n] & bitboard_t<kind>::board_file[f];
-                     if (!bb.is_empty())
-                        if (piece_types->piece_drop_file_maximum[n] < 2 || bb.popcount() >= piece_types->piece_drop_file_maximum[n])
+                  bitboard_t<kind> bb = own & board->bbp[n];
+                  if (piece_types->piece_drop_file_maximum[n] < 2) {
+                     drops &= ~((bb.fill_north() | bb.fill_south()) & bitboard_t<kind>::board_all);
+                  } else {
+                     for (int f = 0; f<bitboard_t<kind>::board_files && !bb.is_empty(); f++) {
+                        bitboard_t<kind> bf = bb & bitboard_t<kind>::board_file[f];
+                        if (bf.popcount() >= piece_types->piece_drop_file_maximum[n])
                            drops &= ~bitboard_t<kind>::board_file[f];
+                        bb &= ~bf;
+                     }
                   }
                }
 
+               move_t drop_move = add_move_retrieve(encode_drop_move(piece, 0), piece, 1);
                while (!drops.is_empty()) {
                   int to = drops.bitscan();
                   drops.reset(to);
-                  move = encode_drop_move(piece, to);
-                  move = add_move_retrieve(move, piece, 1);
-                  movelist->push(move);
+                  movelist->push(set_drop_square(drop_move, to));
 
                   if (board->rule_flags & RF_PROMOTE_ON_DROP) {
                      piece_bit_t c = piece_types->piece_promotion_choice[n] & allowed_promotion_pieces;
@@ -2961,7 +3303,7 @@ struct movegen_t {
    }
 
 
-   void generate_moves(movelist_t *movelist, const board_t<kind> *board, side_t side_to_move, bool quiesc_only = false, uint32_t allowed_piece_deferrals = ~0) const
+   void generate_moves(movelist_t *movelist, const board_t<kind> *board, side_t side_to_move, bool quiesc_only = false, uint32_t allowed_piece_deferrals = ~0, piece_bit_t allowed_drop_pieces = ~0) const
    {
       bitboard_t<kind> destination = bitboard_t<kind>::board_all;
       bitboard_t<kind> origin = bitboard_t<kind>::board_all;
@@ -2985,7 +3327,7 @@ struct movegen_t {
       }
 
       movelist->num_moves = 0;
-      generate_moves_mask(movelist, board, origin, destination, side_to_move, ~0, ~0, allowed_piece_deferrals, quiesc_only);
+      generate_moves_mask(movelist, board, origin, destination, side_to_move, ~0, allowed_drop_pieces, allowed_piece_deferrals, quiesc_only);
 
       if ((board->rule_flags & RF_FORCE_CAPTURE) && !board->ep.is_empty()) {
          bitboard_t<kind> origin;
@@ -2993,12 +3335,12 @@ struct movegen_t {
             if (board->piece_types->piece_flags[n] & PF_TAKE_EP)
                origin |= board->bbp[n];
          origin &= board->bbc[side_to_move];
-         generate_moves_mask(movelist, board, origin, board->ep, side_to_move, ~0, ~0, allowed_piece_deferrals, quiesc_only);
+         generate_moves_mask(movelist, board, origin, board->ep, side_to_move, ~0, allowed_drop_pieces, allowed_piece_deferrals, quiesc_only);
       }
 
       if (movelist->num_moves == 0 && (board->rule_flags & RF_FORCE_CAPTURE) && !quiesc_only) {
          destination = bitboard_t<kind>::board_all ^ board->bbc[next_side[side_to_move]];
-         generate_moves_mask(movelist, board, origin, destination, side_to_move, ~0, ~0, allowed_piece_deferrals, quiesc_only);
+         generate_moves_mask(movelist, board, origin, destination, side_to_move, ~0, allowed_drop_pieces, allowed_piece_deferrals, quiesc_only);
       }
 
       if (quiesc_only) {
@@ -3020,6 +3362,48 @@ finalise:
       return;
    }
 
+   /* Remove all illegal moves from a list of pseudo-legal moves. Only moves
+    * whose legality cannot be decided by test_move_legality() are played on
+    * a copy of the board.
+    */
+   void filter_legal_moves(movelist_t *movelist, const board_t<kind> *board, side_t side_to_move) const
+   {
+      legal_filter_t<kind> lf;
+      board_t<kind> board_copy;
+      bool have_copy = false;
+
+      prepare_legal_filter(&lf, board, side_to_move, player_in_check(board, side_to_move));
+
+      int n = 0;
+      while (n<movelist->num_moves) {
+         move_t move = movelist->move[n];
+         move_legality_t legality = test_move_legality(&lf, board, move);
+
+         if (legality == MOVE_LEGALITY_UNKNOWN) {
+            unmake_info_t<kind> ui;
+            if (!have_copy) board_copy = *board;
+            have_copy = true;
+            board_copy.makemove(move, &ui);
+            legality = player_in_check(&board_copy, side_to_move) ? MOVE_ILLEGAL : MOVE_LEGAL;
+            board_copy.unmakemove(move, &ui);
+         }
+
+         if (legality == MOVE_ILLEGAL) {
+            movelist->num_moves--;
+            movelist->move[n] = movelist->move[movelist->num_moves];
+         } else {
+            n++;
+         }
+      }
+   }
+
+   /* Generate all legal moves */
+   void generate_legal_moves(movelist_t *movelist, const board_t<kind> *board, side_t side_to_move) const
+   {
+      generate_moves(movelist, board, side_to_move);
+      filter_legal_moves(movelist, board, side_to_move);
+   }
+
    stage_t generate_staged_moves(stage_t stage, movelist_t *movelist, const board_t<kind> *board, side_t side_to_move) const
    {
       movelist->clear();
@@ -3033,11 +3417,46 @@ finalise:
       uint32_t defer = board->piece_types->deferral_allowed;
 
       switch (stage) {
-         /* Normal move generation (TODO) */
+         /* Normal move generation. The hash move and killers are looked
+          * up by the search, see generate_piece_moves() and
+          * is_pseudo_legal_move().
+          */
+         case STAGE_HASH:
+         case STAGE_KILLERS:
+         case STAGE_BAD_CAPTURES:
+            break;
+
+         /* Captures and promotions only. All moves to an enemy piece are
+          * generated here; other moves into the promotion zone that do not
+          * promote are left for the quiet stage.
+          */
+         case STAGE_CAPTURES: {
+            bitboard_t<kind> destination = board->bbc[oside] | board->ep;
+            for (int n = 0; n<board->piece_types->num_piece_types; n++)
+               destination |= board->piece_types->promotion_zone[side_to_move][n];
+            generate_moves_mask(movelist, board, bitboard_t<kind>::board_all, destination, side_to_move, ~0, 0, defer);
+            for (int n = 0; n<movelist->num_moves; n++) {
+               move_t move = movelist->move[n];
+               if (!is_capture_move(move) && !is_promotion_move(move)) {
+                  movelist->num_moves--;
+                  movelist->move[n] = movelist->move[movelist->num_moves];
+                  n--;
+               }
+            }
+            break;
+         }
+
+         /* Everything except drops that does not go to an enemy piece */
+         case STAGE_QUIET:
+            generate_moves_mask(movelist, board, bitboard_t<kind>::board_all, ~board->bbc[oside], side_to_move, ~0, 0, defer);
+            break;
+
          case STAGE_DROP:
+            generate_moves_mask(movelist, board, bitboard_t<kind>::board_empty, bitboard_t<kind>::board_all, side_to_move, ~0, ~0, defer);
             break;
 
-         case STAGE_NORMAL:
+         case STAGE_ALL:
+            generate_moves(movelist, board, side_to_move, false, defer);
             break;
 
          /* Mate/Tsume search */
@@ -3078,6 +3497,41 @@ finalise:
       return next_stage[stage];
    }
 
+   /* Generate the moves and drops of one piece type. Used to look up the
+    * move from the transposition table without generating all moves.
+    */
+   void generate_piece_moves(movelist_t *movelist, const board_t<kind> *board, side_t side_to_move, int piece) const
+   {
+      movelist->clear();
+      if (piece >= board->piece_types->num_piece_types) return;
+
+      bitboard_t<kind> origin = board->bbp[piece] & board->bbc[side_to_move];
+      generate_moves_mask(movelist, board, origin, bitboard_t<kind>::board_all, side_to_move, ~0, 1<<piece, board->piece_types->deferral_allowed);
+   }
+
+   /* Test whether a move (a killer, for instance) can be played in the
+    * current position, by generating only the moves between its origin and
+    * destination. The movelist is used as scratch space.
+    */
+   bool is_pseudo_legal_move(movelist_t *movelist, const board_t<kind> *board, side_t side_to_move, move_t move) const
+   {
+      uint32_t defer = board->piece_types->deferral_allowed;
+      int to = get_move_to(move);
+
+      movelist->clear();
+      if (is_drop_move(move)) {
+         int piece = get_move_piece(move);
+         if (piece >= board->piece_types->num_piece_types) return false;
+         generate_moves_mask(movelist, board, bitboard_t<kind>::board_empty, bitboard_t<kind>::square_bitboards[to], side_to_move, ~0, 1<<piece, defer);
+      } else {
+         int from = get_move_from(move);
+         if (!board->bbc[side_to_move].test(from)) return false;
+         generate_moves_mask(movelist, board, bitboard_t<kind>::square_bitboards[from], bitboard_t<kind>::square_bitboards[to], side_to_move, ~0, 0, defer);
+      }
+
+      return movelist->contains(move);
+   }
+
    void generate_chase_candidates(movelist_t *movelist, const board_t<kind> *board, side_t side_to_move) const
    {
       assert(board->rule_flags & RF_USE_CHASERULE);
@@ -1,42 +1,101 @@
 #ifndef MOVELIST_H
 #define MOVELIST_H
 
+#include <stdlib.h>
+#include <string.h>
+#include "compilerdef.h"
 #include "move.h"
 
-/* datastructure to hold the number of legal moves in a position */
-#define MAX_MOVES    256
+/* datastructure to hold the number of legal moves in a position
+ * The first MAX_MOVES moves are stored in the list itself, so move lists can
+ * live on the stack (or in an array, one per ply) without allocating memory.
+ * Variants loaded from a file can have more moves than that in a position;
+ * if the list fills up it moves to a larger buffer on the heap.
+ */
+#define MAX_MOVES    1024
+
+/* Number of moves that are picked by a linear scan before the rest of the
+ * list is sorted. Most nodes cut off (or run out of good moves) before
+ * that.
+ */
+#define MOVELIST_SCAN_PICKS 3
+
 typedef struct movelist_t {
    move_t *move;
    int *score;
    int num_moves;
    int cur_move;
    int max_moves;
+   int sorted_end;            /* Moves before this are in order */
+   int scan_picks;            /* Moves picked by a scan since the last change */
+   move_t move_store[MAX_MOVES];
+   int score_store[MAX_MOVES];
 
    movelist_t () { 
-      cur_move = num_moves = 0;
+      move  = move_store;
+      score = score_store;
+      max_moves = MAX_MOVES;
+      clear();
+   }
+
+   movelist_t (const movelist_t &ml) {
+      move  = move_store;
+      score = score_store;
       max_moves = MAX_MOVES;
-      move  = (move_t *)malloc(max_moves * sizeof *move);
-      score = (int *)malloc(max_moves * sizeof *score);
+      *this = ml;
    }
+
    ~movelist_t() {
-      free(move);
-      free(score);
+      if (move != move_store) {
+         free(move);
+         free(score);
+      }
+   }
+
+   movelist_t &operator = (const movelist_t &ml)
+   {
+      if (this == &ml) return *this;
+      clear();
+      while (max_moves < ml.num_moves) grow();
+      memcpy(move, ml.move, ml.num_moves * sizeof *move);
+      memcpy(score, ml.score, ml.num_moves * sizeof *score);
+      num_moves  = ml.num_moves;
+      cur_move   = ml.cur_move;
+      sorted_end = ml.sorted_end;
+      scan_picks = ml.scan_picks;
+      return *this;
    }
 
    void clear()
    {
       cur_move = num_moves = 0;
+      sorted_end = scan_picks = 0;
+   }
+
+   /* Double the storage, moving to the heap if the moves were stored in
+    * the list itself.
+    */
+   void grow()
+   {
+      int new_max = 2*max_moves;
+      if (move == move_store) {
+         move  = (move_t *)malloc(new_max * sizeof *move);
+         score = (int *)malloc(new_max * sizeof *score);
+         memcpy(move, move_store, num_moves * sizeof *move);
+         memcpy(score, score_store, num_moves * sizeof *score);
+      } else {
+         move  = (move_t *)realloc(move, new_max * sizeof *move);
+         score = (int *)realloc(score, new_max * sizeof *score);
+      }
+      max_moves = new_max;
    }
 
    void push(move_t m)
    {
+      if (expect(num_moves >= max_moves, false)) grow();
       move[num_moves++] = m;
-
-      if (num_moves >= max_moves) {
-         max_moves += MAX_MOVES;
-         move  = (move_t *)realloc(move, max_moves * sizeof *move);
-         score = (int *)realloc(score, max_moves * sizeof *score);
-      }
+      sorted_end = cur_move;
+      scan_picks = 0;
    }
 
    void print() const
@@ -70,32 +129,82 @@ typedef struct movelist_t {
       score[cur_move-1] = s;
    }
 
+   /* Scores of moves that have not been picked yet were changed */
+   void scores_changed()
+   {
+      sorted_end = cur_move;
+      scan_picks = 0;
+   }
+
    void rewind()
    {
       cur_move = 0;
+      scores_changed();
    }
 
-   move_t next_move()
+   /* Sort the moves from cur_move onwards, best first (Shell sort) */
+   void sort_remaining()
    {
-      move_t m = 0;
+      static const int gaps[] = { 301, 132, 57, 23, 10, 4, 1 };
+      int first = cur_move;
 
-      if (cur_move < num_moves) {
-         int nm = cur_move;
-         int sv = score[nm];
-         int n;
-         for (n=cur_move+1; n<num_moves; n++) {
-            if (score[n] > score[nm])
-               nm = n;
+      for (size_t g = 0; g<sizeof gaps / sizeof *gaps; g++) {
+         int gap = gaps[g];
+         for (int n = first+gap; n<num_moves; n++) {
+            move_t m = move[n];
+            int s = score[n];
+            int k = n;
+            while (k >= first+gap && score[k-gap] < s) {
+               move[k] = move[k-gap];
+               score[k] = score[k-gap];
+               k -= gap;
+            }
+            move[k] = m;
+            score[k] = s;
          }
-         n = cur_move;
-         m = move[n]; move[n] = move[nm]; move[nm] = m;
-         sv = score[n]; score[n] = score[nm]; score[nm] = sv;
+      }
+      sorted_end = num_moves;
+   }
+
+   /* Bring the best of the remaining moves to cur_move */
+   void select_next()
+   {
+      if (cur_move < sorted_end && sorted_end <= num_moves) return;
+
+      if (scan_picks >= MOVELIST_SCAN_PICKS) {
+         sort_remaining();
+         return;
+      }
 
-         m = move[cur_move];
-         cur_move++;
+      int nm = cur_move;
+      for (int n=cur_move+1; n<num_moves; n++) {
+         if (score[n] > score[nm])
+            nm = n;
       }
+      move_t m = move[cur_move]; move[cur_move] = move[nm]; move[nm] = m;
+      int sv = score[cur_move]; score[cur_move] = score[nm]; score[nm] = sv;
+      sorted_end = cur_move+1;
+      scan_picks++;
+   }
+
+   move_t next_move()
+   {
+      if (cur_move >= num_moves) return 0;
+
+      select_next();
+      return move[cur_move++];
+   }
+
+   /* As next_move(), but leave the remaining moves alone if none of them
+    * scores at least min_score.
+    */
+   move_t next_move(int min_score)
+   {
+      if (cur_move >= num_moves) return 0;
 
-      return m;
+      select_next();
+      if (score[cur_move] < min_score) return 0;
+      return move[cur_move++];
    }
 
    void show()
@@ -0,0 +1,236 @@
+/*  Sjaak, a program for playing chess variants
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Perft: count all positions that can be reached in a given number of
+ * moves, to test (and time) the move generator.
+ * The root moves are divided over the helper threads and node counts are
+ * cached in a hash table. With legal move generation (lperft), moves at
+ * the last ply are counted without being played. Plain perft plays every
+ * move and tests whether it leaves the king in check, as an independent
+ * check on the legality filter.
+ */
+
+/* Number of entries in the perft hash table (16 bytes each) */
+#define PERFT_HASH_SIZE (1<<21)
+
+/* The hash key of the current position for perft. The normal hash key
+ * does not include the en-passant square or the unmoved pieces (beyond
+ * the castle flags), which the move generator does depend on.
+ */
+uint64_t perft_key(int depth, bool legal) const
+{
+   uint64_t key = board.hash;
+
+   if (board.ep_victim) key ^= en_passant_key[board.ep_victim];
+
+   uint64_t iv = (uint64_t)board.init.bb ^ (uint64_t)(board.init.bb >> (4*sizeof(kind)) >> (4*sizeof(kind)));
+   key ^= (iv + board.board_flags) * 0x9E3779B97F4A7C15ull;
+   key ^= (uint64_t)(2*depth + legal) * 0xC2B2AE3D27D4EB4Full;
+
+   return key;
+}
+
+uint64_t perft_count(int depth, bool legal)
+{
+   movelist_t *ml = movelist + depth;
+   side_t me = board.side_to_move;
+   uint64_t nodes = 0;
+
+   if (depth == 0) return 1;
+
+   /* Bulk counting: at the last ply we only need the number of legal moves */
+   if (depth == 1 && legal) {
+      generate_legal_moves(ml);
+      return ml->num_moves;
+   }
+
+   /* The last ply is not worth storing */
+   uint64_t key = 0;
+   if (depth > 1) {
+      key = perft_key(depth, legal);
+      if (query_perft_table_entry(perft_table, key, depth, &nodes))
+         return nodes;
+   }
+
+   if (legal)
+      generate_legal_moves(ml);
+   else
+      generate_moves(ml);
+
+   for (int n=0; n<ml->num_moves; n++) {
+      playmove(ml->move[n]);
+      if (legal || !player_in_check(me)) {   /* Don't count illegal moves */
+         if (depth == 1) {
+            nodes++;
+         } else {
+            test_move_game_check();
+            nodes += perft_count(depth-1, legal);
+         }
+      }
+      takeback();
+      if (abort_search) return nodes;
+   }
+
+   if (depth > 1) store_perft_hash_entry(perft_table, key, depth, nodes);
+   return nodes;
+}
+
+/* Perft with sub-totals for each move, printed down to "root" plies */
+uint64_t perft_divide(int depth, int root, bool legal)
+{
+   movelist_t *ml = movelist + depth;
+   side_t me = board.side_to_move;
+   uint64_t nodes = 0;
+
+   if (depth == 0) return 1;
+   if (root <= 0) return perft_count(depth, legal);
+
+   if (legal)
+      generate_legal_moves(ml);
+   else
+      generate_moves(ml);
+
+   for (int n=0; n<ml->num_moves; n++) {
+      uint64_t count = 0;
+      playmove(ml->move[n]);
+      if (legal || !player_in_check(me)) {
+         test_move_game_check();
+         count = perft_divide(depth-1, root-1, legal);
+      }
+      nodes += count;
+      printf("%8s %10" PRIu64 " %10" PRIu64 "\n", move_to_string(ml->move[n], NULL), count, nodes);
+      takeback();
+      if (abort_search) break;
+   }
+   return nodes;
+}
+
+/* Work for the perft threads: the legal root moves, claimed one at a time */
+struct perft_job_t {
+   game_template_t<kind> *master;
+   movelist_t *moves;
+   uint64_t *count;
+   int depth;
+   bool legal;
+   volatile int next_move;
+};
+
+void perft_root_moves(perft_job_t *job)
+{
+   int n;
+   while ((n = __sync_fetch_and_add(&job->next_move, 1)) < job->moves->num_moves) {
+      playmove(job->moves->move[n]);
+      test_move_game_check();
+      job->count[n] = perft_count(job->depth-1, job->legal);
+      takeback();
+      if (abort_search) break;
+   }
+}
+
+static void perft_job(void *data, int thread_id)
+{
+   perft_job_t *job = (perft_job_t *)data;
+
+   job->master->helper[thread_id-1]->perft_root_moves(job);
+}
+
+uint64_t perft(int depth, int root = 0, bool legal = false)
+{
+   movelist_t moves;
+   uint64_t *count;
+   uint64_t nodes = 0;
+   side_t me = board.side_to_move;
+   int threads = get_number_of_threads();
+
+   if (depth <= 0) return 1;
+
+   /* The table is kept for the next call, see clear_perft_table() */
+   if (!perft_table)
+      perft_table = create_perft_hash_table(PERFT_HASH_SIZE);
+
+   /* Nested sub-totals are printed as they are found, so they can not be
+    * calculated in parallel.
+    */
+   if (root > 1 || depth == 1 || threads <= 1) {
+      return perft_divide(depth, root, legal);
+   }
+
+   /* Remove illegal moves at the root */
+   if (legal) {
+      generate_legal_moves(&moves);
+   } else {
+      generate_moves(&moves);
+      int n = 0;
+      while (n<moves.num_moves) {
+         playmove(moves.move[n]);
+         bool illegal = player_in_check(me);
+         takeback();
+         if (illegal) {
+            moves.num_moves--;
+            moves.move[n] = moves.move[moves.num_moves];
+         } else {
+            n++;
+         }
+      }
+   }
+   count = (uint64_t *)calloc(moves.num_moves + 1, sizeof *count);
+
+   if (num_helpers > threads-1)
+      destroy_helpers();
+
+   while (num_helpers < threads-1) {
+      helper[num_helpers] = create_helper(num_helpers+1);
+      num_helpers++;
+   }
+
+   for (int n=0; n<num_helpers; n++) {
+      helper[n]->copy_search_position(this);
+      helper[n]->perft_table = perft_table;
+   }
+
+   perft_job_t job;
+   job.master = this;
+   job.moves = &moves;
+   job.count = count;
+   job.depth = depth;
+   job.legal = legal;
+   job.next_move = 0;
+
+   start_helper_threads(perft_job, &job);
+   perft_root_moves(&job);
+   wait_helper_threads();
+
+   for (int n=0; n<num_helpers; n++)
+      helper[n]->perft_table = NULL;
+
+   for (int n=0; n<moves.num_moves && !abort_search; n++) {
+      nodes += count[n];
+      if (root > 0)
+         printf("%8s %10" PRIu64 " %10" PRIu64 "\n", move_to_string(moves.move[n], NULL), count[n], nodes);
+   }
+   free(count);
+
+   return nodes;
+}
+
+/* Forget the node counts of earlier perft runs. The table itself is kept:
+ * re-allocating it for every depth costs more than the shallow perfts.
+ */
+void clear_perft_table()
+{
+   clear_perft_hash_table(perft_table);
+}
@@ -0,0 +1,55 @@
+/*  Sjaak, a program for playing chess variants
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PERFTHASH_H
+#define PERFTHASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "bool.h"
+#include "large_malloc.h"
+
+/* Hash table for perft node counts. The table is shared between threads
+ * without locks: the lock is stored XOR the data, so an entry that was
+ * torn by two simultaneous writes is simply not found.
+ */
+typedef struct {
+   uint64_t lock;
+   uint64_t data;          /* Node count (upper 56 bits) and depth */
+} perft_hash_t;
+
+typedef struct {
+   perft_hash_t *data;
+   size_t number_of_elements;
+   size_t memory_size;
+   large_malloc_backing_t backing;
+   bool interleaved;
+} perft_hash_table_t;
+
+perft_hash_table_t *create_perft_hash_table(size_t nelem);
+void destroy_perft_hash_table(perft_hash_table_t *table);
+void clear_perft_hash_table(perft_hash_table_t *table);
+bool query_perft_table_entry(perft_hash_table_t *table, uint64_t key, int depth, uint64_t *nodes);
+void store_perft_hash_entry(perft_hash_table_t *table, uint64_t key, int depth, uint64_t nodes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
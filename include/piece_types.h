@@ -115,6 +115,7 @@ struct piece_description_t {
    int          val_perm[MAX_PIECE_TYPES];
    int16_t      piece_value[MAX_PIECE_TYPES];
    int16_t      see_piece_value[MAX_PIECE_TYPES];
+   bool         negative_piece_values;   /* Some piece has a value < 0 (suicide) */
    int16_t      piece_promotion_value[MAX_PIECE_TYPES];
 
    bitboard_t<kind>  passer_mask[NUM_SIDES][8*sizeof(kind)];
@@ -139,6 +140,7 @@ struct piece_description_t {
    int         king_safety_weight[MAX_PIECE_TYPES];
    int         phase_weight[MAX_PIECE_TYPES];
    int         phase_scale;
+   eval_t      lazy_margin;    /* Margin for lazy evaluation, 0 disables it */
    int         avg_moves[MAX_PIECE_TYPES];
    int         max_moves[MAX_PIECE_TYPES];
    int         min_moves[MAX_PIECE_TYPES];
@@ -157,7 +159,9 @@ struct piece_description_t {
    void sort_piece_values() {
       value_comparator_t compare;
 
+      negative_piece_values = false;
       for (int n=0; n<num_piece_types; n++) {
+         if (piece_value[n] < 0) negative_piece_values = true;
          compare.sort_value[n] = piece_value[n];
          if (piece_flags[n] & PF_ROYAL)
             compare.sort_value[n] += 16000;
@@ -212,9 +212,11 @@ inline bool material_draw()
 
    if (lone_king(WHITE) && lone_king(BLACK)) return true;
 
-   /* TODO */
+   /* Insufficient material, but only if mate is the only way to win */
+   if (board.rule_flags & (RF_USE_BARERULE | RF_USE_CAPTURE)) return false;
+   if (check_limit || stale_score != LEGALDRAW || mate_score != -LEGALWIN) return false;
 
-   return false;
+   return probe_material()->draw;
 }
 
 inline bool lone_king(side_t side)
@@ -263,11 +265,32 @@ bool is_recapture_move(move_t move, move_t prev_move)
           get_move_to(move) == get_move_to(prev_move);
 }
 
-void score_moves(int depth, move_t hash_move, move_t prev_move, move_t threat_move)
+/* Recover the full move from the compressed move stored in the
+ * transposition table, by matching it against a list of generated moves.
+ */
+move_t expand_hash_move(const movelist_t *movelist, hash_move_t hash_move) const
+{
+   if (hash_move == 0) return 0;
+
+   for (int n = 0; n<movelist->num_moves; n++)
+      if (compress_hash_move(movelist->move[n]) == hash_move)
+         return movelist->move[n];
+
+   return 0;
+}
+
+void score_moves(int depth, move_t hash_move, move_t prev_move, move_t threat_move, int first = 0)
 {
    const side_t me = board.side_to_move;
 
-   for (int n = 0; n<movelist[depth].num_moves; n++) {
+   /* Squares the opponent attacks, used to skip the static exchange
+    * evaluation for drops to squares nobody can capture on. Only
+    * calculated when there are drops to score.
+    */
+   bitboard_t<kind> enemy_attacks;
+   bool have_enemy_attacks = false;
+
+   for (int n = first; n<movelist[depth].num_moves; n++) {
       move_t move = movelist[depth].move[n];
       movelist[depth].score[n] = 0;
       if (move == hash_move) {
@@ -314,7 +337,11 @@ void score_moves(int depth, move_t hash_move, move_t prev_move, move_t threat_mo
       } else if (is_drop_move(move)) {
          int history_score = get_move_history_score(move);
          int history_scale = get_move_history_scale(move);
-         int s = see(move);
+         if (!have_enemy_attacks) {
+            enemy_attacks = movegen.generate_attack_bitboard(&board, bitboard_t<kind>::board_empty, board.bbc[next_side[me]], next_side[me]);
+            have_enemy_attacks = true;
+         }
+         int s = enemy_attacks.test(get_move_to(move)) ? see(move) : 0;
          if (s > 0) {
             int h = history_scale ? 100 * history_score / history_scale : 100;
             if (!(board.bbc[me] & board.royal & bitboard_t<kind>::neighbour_board[get_move_to(move)]).is_empty())
@@ -324,6 +351,7 @@ void score_moves(int depth, move_t hash_move, move_t prev_move, move_t threat_mo
             movelist[depth].score[n] += s / 10;
          } else {
             int h = history_scale ? 500 * history_score / history_scale : 500;
+            h += 250 * get_continuation_history_score(prev_move, move) / HISTORY_MAX;
             movelist[depth].score[n] += s + h;
          }
       } else if (max_history && !board.check() && !is_promotion_move(move) && !is_capture_move(move)) {
@@ -331,6 +359,7 @@ void score_moves(int depth, move_t hash_move, move_t prev_move, move_t threat_mo
          int history_scale = get_move_history_scale(move);
          if (history_scale) {
             int s = 500 * history_score / history_scale;
+            s += 250 * get_continuation_history_score(prev_move, move) / HISTORY_MAX;
             if (s) {
                movelist[depth].score[n] = 0 + s;
             } else {
@@ -358,6 +387,204 @@ void score_moves(int depth, move_t hash_move, move_t prev_move, move_t threat_mo
    }
 }
 
+/* Staged move generation for the main search: the hash move, good
+ * captures and promotions, killers and the counter move, quiet moves,
+ * drops and finally the bad captures. Moves of later stages are only
+ * generated (and scored) if none of the earlier moves caused a cut-off.
+ * All stages share movelist[depth], so the moves that have been tried are
+ * always at the start of the list.
+ */
+#define BAD_CAPTURE_PENALTY (1<<24)
+
+/* Moves that a later stage may generate again: the hash move, the killers
+ * and captures or promotions that do not land on an enemy piece. Normally
+ * only a handful; if there are more, the whole list is searched.
+ */
+#define MAX_STAGED_DUPLICATES 32
+
+struct move_picker_t {
+   stage_t stage;
+   int min_score;       /* Moves scoring less wait for the next stage */
+   move_t hash_move;
+   hash_move_t tt_move;
+   move_t prev_move;
+   move_t threat_move;
+   move_t duplicate[MAX_STAGED_DUPLICATES];
+   int num_duplicates;  /* More than MAX_STAGED_DUPLICATES: see the list */
+};
+
+void init_move_picker(move_picker_t *mp, int depth, move_t hash_move, hash_move_t tt_move, move_t prev_move, move_t threat_move)
+{
+   bool staged = !board.check() &&
+                 !(board.rule_flags & (RF_FORCE_CAPTURE | RF_FORCE_DROPS | RF_GATE_DROPS | RF_ALLOW_PICKUP));
+
+   mp->stage       = staged ? STAGE_HASH : STAGE_ALL;
+   mp->min_score   = 0;
+   mp->hash_move   = hash_move;
+   mp->tt_move     = tt_move;
+   mp->prev_move   = prev_move;
+   mp->threat_move = threat_move;
+   mp->num_duplicates = 0;
+   movelist[depth].clear();
+}
+
+void add_staged_duplicate(move_picker_t *mp, move_t move)
+{
+   if (mp->num_duplicates < MAX_STAGED_DUPLICATES)
+      mp->duplicate[mp->num_duplicates] = move;
+   mp->num_duplicates++;
+}
+
+bool is_staged_duplicate(int depth, const move_picker_t *mp, move_t move) const
+{
+   if (mp->num_duplicates > MAX_STAGED_DUPLICATES)
+      return movelist[depth].contains(move);
+
+   for (int n = 0; n<mp->num_duplicates; n++)
+      if (mp->duplicate[n] == move) return true;
+   return false;
+}
+
+/* Append the moves from the scratch list that were not tried yet */
+void append_staged_moves(int depth, move_picker_t *mp, const movelist_t *moves)
+{
+   movelist_t *ml = &movelist[depth];
+
+   for (int n = 0; n<moves->num_moves; n++) {
+      move_t move = moves->move[n];
+      if (!is_staged_duplicate(depth, mp, move))
+         ml->push(move);
+   }
+}
+
+void add_staged_killer(int depth, move_picker_t *mp, move_t move)
+{
+   movelist_t *ml = &movelist[depth];
+   /* Only the hash move and the captures are in the list at this point */
+   if (move == 0 || ml->contains(move)) return;
+   if (movegen.is_pseudo_legal_move(&stage_movelist, &board, board.side_to_move, move)) {
+      ml->push(move);
+      add_staged_duplicate(mp, move);
+   }
+}
+
+move_t next_staged_move(int depth, move_picker_t *mp)
+{
+   movelist_t *ml = &movelist[depth];
+   const side_t me = board.side_to_move;
+
+   while (true) {
+      move_t move = ml->next_move(mp->min_score);
+      if (move) {
+         if (ml->get_move_score() < -BAD_CAPTURE_PENALTY/2)
+            ml->set_move_score(ml->get_move_score() + BAD_CAPTURE_PENALTY);
+         return move;
+      }
+
+      if (mp->stage == STAGE_DONE) return 0;
+
+      int first = ml->num_moves;
+      switch (mp->stage) {
+         case STAGE_HASH:
+            /* The move from internal iterative deepening may be stale if
+             * that search returned early, so it is verified first.
+             */
+            if (mp->hash_move && !movegen.is_pseudo_legal_move(&stage_movelist, &board, me, mp->hash_move))
+               mp->hash_move = 0;
+            if (mp->hash_move == 0 && mp->tt_move) {
+               movegen.generate_piece_moves(&stage_movelist, &board, me, get_move_piece(mp->tt_move));
+               mp->hash_move = expand_hash_move(&stage_movelist, mp->tt_move);
+            }
+            if (mp->hash_move) {
+               ml->push(mp->hash_move);
+               add_staged_duplicate(mp, mp->hash_move);
+            }
+            mp->min_score = -LEGALWIN;
+            break;
+
+         case STAGE_CAPTURES:
+            movegen.generate_staged_moves(mp->stage, &stage_movelist, &board, me);
+            append_staged_moves(depth, mp, &stage_movelist);
+
+            /* The quiet stage generates all moves that do not go to an
+             * enemy piece, which includes en-passant captures and
+             * promotions to empty squares.
+             */
+            for (int n = first; n<ml->num_moves; n++)
+               if (!board.bbc[next_side[me]].test(get_move_to(ml->move[n])))
+                  add_staged_duplicate(mp, ml->move[n]);
+            mp->min_score = 2200;
+            break;
+
+         case STAGE_KILLERS:
+            /* Captures that are still left lose material; they are tried
+             * after all other moves.
+             */
+            for (int n = ml->cur_move; n<ml->num_moves; n++)
+               if (ml->score[n] < 0) ml->score[n] -= BAD_CAPTURE_PENALTY;
+            ml->scores_changed();
+
+            add_staged_killer(depth, mp, mate_killer[depth]);
+            add_staged_killer(depth, mp, mate_killer[depth+2]);
+            add_staged_killer(depth, mp, killer[depth][0]);
+            add_staged_killer(depth, mp, killer[depth][1]);
+            if (depth > 2) {
+               add_staged_killer(depth, mp, killer[depth-2][0]);
+               add_staged_killer(depth, mp, killer[depth-2][1]);
+            }
+            add_staged_killer(depth, mp, killer[depth+2][0]);
+            add_staged_killer(depth, mp, killer[depth+2][1]);
+            if (mp->prev_move) {
+               int to   = get_move_to(mp->prev_move);
+               int from = is_drop_move(mp->prev_move) ? to : get_move_from(mp->prev_move);
+               add_staged_killer(depth, mp, counter[from][to][me]);
+            }
+            mp->min_score = 800;
+            break;
+
+         case STAGE_QUIET:
+         case STAGE_DROP:
+            movegen.generate_staged_moves(mp->stage, &stage_movelist, &board, me);
+            append_staged_moves(depth, mp, &stage_movelist);
+            mp->min_score = -BAD_CAPTURE_PENALTY/2;
+            break;
+
+         case STAGE_ALL:
+            movegen.generate_staged_moves(mp->stage, ml, &board, me);
+            mp->min_score = -LEGALWIN - BAD_CAPTURE_PENALTY;
+            break;
+
+         case STAGE_BAD_CAPTURES:
+         default:
+            mp->min_score = -LEGALWIN - BAD_CAPTURE_PENALTY;
+            break;
+      }
+
+      /* The hash move may not have been found in the first stage */
+      if (mp->hash_move == 0 && mp->tt_move) {
+         for (int n = first; n<ml->num_moves; n++)
+            if (compress_hash_move(ml->move[n]) == mp->tt_move) {
+               mp->hash_move = ml->move[n];
+               break;
+            }
+      }
+
+      score_moves(depth, mp->hash_move, mp->prev_move, mp->threat_move, first);
+      mp->stage = next_stage[mp->stage];
+   }
+}
+
+/* Start loading the hash table entries for the position after the move,
+ * so that they are (hopefully) in cache by the time they are probed.
+ */
+void prefetch_move(move_t move)
+{
+   uint64_t key = hash_after_move(move);
+   prefetch_hashtable(transposition_table, key);
+   prefetch_evaltable(eval_table, key);
+   prefetch_see_cache(key);
+}
+
 int qsearch(int alpha, int beta, int draft, int depth)
 {
    int score = -LEGALWIN;
@@ -379,13 +606,37 @@ int qsearch(int alpha, int beta, int draft, int depth)
    if (depth >= MAX_TOTAL_DEPTH)
       return static_qsearch(beta, depth+1);
 
+   /* Test for transposition table cut-offs. Entries from the main search
+    * always have enough depth; entries from quiescence search are stored
+    * with the (zero or negative) draft.
+    */
+   int hash_depth = 0, hash_score = 0;
+   unsigned int hash_flag = 0;
+   hash_move_t tt_move = 0;
+   bool have_hash = qsearch_hash && retrieve_table(transposition_table, board.hash, &hash_depth, &hash_score, &hash_flag, &tt_move);
+   if (have_hash && hash_depth >= draft && (fifty_limit == 0 || board.fifty_counter < fifty_scale_limit)) {
+      hash_score = score_from_hashtable(hash_score, depth);
+      bool exact_ok = (beta == alpha+1) || (hash_score <= alpha) || hash_score >= beta;
+      if ((hash_flag & HASH_TYPE_EXACT) && exact_ok) {
+         return hash_score;
+      } else if ((hash_flag & (HASH_TYPE_UPPER|HASH_TYPE_EXACT)) && (hash_score<=alpha)) {
+         return hash_score;
+      } else if ((hash_flag & (HASH_TYPE_LOWER|HASH_TYPE_EXACT)) && (hash_score>=beta)) {
+         return hash_score;
+      }
+   }
+
    int static_score = 0;
+   int alpha_in = alpha;
    if (!board.check()) {
       static_score = static_evaluation<false>(me, alpha, beta);
 
       /* Stand-pat cut-off */
-      if (static_score >= beta)
+      if (static_score >= beta) {
+         if (qsearch_hash && !abort_search)
+            store_table_entry(transposition_table, board.hash, draft, static_score, HASH_TYPE_LOWER, 0);
          return static_score;
+      }
 
       if (static_score > alpha)
          alpha = static_score;
@@ -404,7 +655,8 @@ int qsearch(int alpha, int beta, int draft, int depth)
    assert(moves_played > 0);
    move_t prev_move = move_list[moves_played-1];
 
-   /* Score and sort the moves */
+   /* Score and sort the moves, the hash move goes first */
+   move_t hash_move = tt_move ? expand_hash_move(&movelist[depth], tt_move) : 0;
    for (int n = 0; n<movelist[depth].num_moves; n++) {
       move_t move = movelist[depth].move[n];
       /* TODO: LVA/MVV or SEE ordering */
@@ -412,6 +664,8 @@ int qsearch(int alpha, int beta, int draft, int depth)
       movelist[depth].score[n] = move_mvvlva(move);
       if (is_promotion_move(move))
          movelist[depth].score[n] += pt.piece_value[get_move_promotion_piece(move)];
+      if (move == hash_move)
+         movelist[depth].score[n] = LEGALWIN;
    }
 
    /* Search all other moves, until we find a cut-off
@@ -422,16 +676,23 @@ int qsearch(int alpha, int beta, int draft, int depth)
    int best_score = score;
    int best_score2 = best_score;
    move_t move;
+   legal_filter_t<kind> lf;
+   movegen.prepare_legal_filter(&lf, &board, me, board.check());
    while (alpha < beta && (move = movelist[depth].next_move())) {
       if (!board.check()) {
-         int ms = see(move);//movelist[depth].get_move_score();
-         if (ms < 0) continue;
          if (!is_promotion_move(move) && !is_capture_move(move)) continue;
          if (is_drop_move(move)) continue;
+         if (!see_ge(move, 0)) continue;
       }
       if (is_pickup_move(move)) continue;
+      move_legality_t legality = movegen.test_move_legality(&lf, &board, move);
+      if (legality == MOVE_ILLEGAL) {
+         legal_moves--;
+         continue;
+      }
+      prefetch_move(move);
       playmove(move);
-      if (player_in_check(me)) {
+      if (legality == MOVE_LEGALITY_UNKNOWN && player_in_check(me)) {
          legal_moves--;
          takeback();
          continue;
@@ -448,6 +709,7 @@ int qsearch(int alpha, int beta, int draft, int depth)
 
       if (score > alpha) { /* New best line */
          alpha = score;
+         hash_move = move;
          backup_principle_variation(depth, move);
       }
    }
@@ -455,6 +717,17 @@ int qsearch(int alpha, int beta, int draft, int depth)
    if (board.rule_flags & RF_ALLOW_PICKUP) best_score = best_score2;
    if (best_score == -LEGALWIN) best_score = static_score;
 
+   /* Store the result in the transposition table. Mate scores are not
+    * stored: whether a mate in quiescence search counts depends on the
+    * moves leading up to it.
+    */
+   if (qsearch_hash && !abort_search && !(board.check() && legal_moves == 0) && !is_mate_score(best_score)) {
+      unsigned int flag = HASH_TYPE_EXACT;
+      if (best_score <= alpha_in) flag = HASH_TYPE_UPPER;
+      if (best_score >= beta)     flag = HASH_TYPE_LOWER;
+      store_table_entry(transposition_table, board.hash, draft, best_score, flag, (flag == HASH_TYPE_UPPER) ? 0 : hash_move);
+   }
+
    if (board.check() && legal_moves == 0) {
       best_score = (mate_score + depth);
 
@@ -642,6 +915,13 @@ int search(int alpha, int beta, int draft, int depth)
          return alpha-1;
       }
 
+      /* If we can repeat an earlier position, we can get at least a draw */
+      if (alpha < LEGALDRAW && rep_score == LEGALDRAW && !(board.rule_flags & RF_USE_CHASERULE) && upcoming_repetition()) {
+         alpha = LEGALDRAW;
+         if (alpha >= beta)
+            return alpha;
+      }
+
       if (material_draw())
          return LEGALDRAW;
 
@@ -689,8 +969,9 @@ int search(int alpha, int beta, int draft, int depth)
    /* Test for transposition table cut-offs */
    int hash_depth = 0, hash_score = 0;
    unsigned int hash_flag = 0;
+   hash_move_t tt_move = 0;
    move_t hash_move = 0;
-   bool have_hash = retrieve_table(transposition_table, board.hash, &hash_depth, &hash_score, &hash_flag, &hash_move);
+   bool have_hash = retrieve_table(transposition_table, board.hash, &hash_depth, &hash_score, &hash_flag, &tt_move);
    bool hash_ok   = hash_depth >= draft || is_mate_score(hash_score);
    if (have_hash && hash_ok && (fifty_limit == 0 || board.fifty_counter < fifty_scale_limit) && depth > 0) {
       hash_score = score_from_hashtable(hash_score, depth);
@@ -698,7 +979,14 @@ int search(int alpha, int beta, int draft, int depth)
       //bool exact_ok = (depth > 1) || (beta == alpha+1);
       bool exact_ok = (beta == alpha+1) || (hash_score <= alpha) || hash_score >= beta;     // FIXME: use crafty-like PV table
       if ((hash_flag & HASH_TYPE_EXACT) && exact_ok) {
-         if (hash_score > alpha) backup_principle_variation(depth, hash_move);
+         /* The PV only matters in PV nodes, so only pay for expanding the
+          * hash move there.
+          */
+         if (hash_score > alpha && beta > alpha+1) {
+            movelist[depth].clear();
+            movegen.generate_moves(&movelist[depth], &board, me, false, pt.deferral_allowed);
+            backup_principle_variation(depth, expand_hash_move(&movelist[depth], tt_move));
+         }
 
          return hash_score;
       } else if ((hash_flag & (HASH_TYPE_UPPER|HASH_TYPE_EXACT)) && (hash_score<=alpha)) {
@@ -768,32 +1056,37 @@ int search(int alpha, int beta, int draft, int depth)
    }
 
    /* Internal iterative deepening */
-   if (hash_move == 0 && beta>alpha+1 && draft > 3) {
+   if (tt_move == 0 && beta>alpha+1 && draft > 3) {
       int score = search(alpha, beta, draft-2, depth);
       if (score > alpha)
          hash_move = best_move[depth];
    }
 
-   /* Generate all moves */
-   movelist[depth].clear();
-   movegen.generate_moves(&movelist[depth], &board, me, false, pt.deferral_allowed);
-   int legal_moves = movelist[depth].num_moves;
+   /* Moves are generated and scored in stages, as they are needed */
+   move_picker_t picker;
+   init_move_picker(&picker, depth, hash_move, tt_move, prev_move, threat_move);
+   int legal_moves = 0;
 
-   /* No moves generated at all? */
-   if (legal_moves == 0)
-      goto no_moves;
-
-   /* Score and sort the moves */
-   score_moves(depth, hash_move, prev_move, threat_move);
+   /* Most moves can be shown to be legal (or not) without playing them */
+   legal_filter_t<kind> lf;
+   movegen.prepare_legal_filter(&lf, &board, me, board.check());
 
    /* Search the first move */
    hash_flag = HASH_TYPE_UPPER;
-   while ((move = movelist[depth].next_move())) {
+   while ((move = next_staged_move(depth, &picker))) {
+      legal_moves++;
+
       /* Multi-pv mode */
       if (multipv > 1 && depth == 0 && exclude.contains(move)) continue;
       int move_score = movelist[depth].get_move_score();
+      move_legality_t legality = movegen.test_move_legality(&lf, &board, move);
+      if (legality == MOVE_ILLEGAL) {
+         legal_moves--;
+         continue;
+      }
+      prefetch_move(move);
       playmove(move);
-      if (player_in_check(me)) {   /* Illegal move */
+      if (legality == MOVE_LEGALITY_UNKNOWN && player_in_check(me)) {   /* Illegal move */
          legal_moves--;
          takeback();
          continue;
@@ -824,7 +1117,8 @@ int search(int alpha, int beta, int draft, int depth)
    /* Search all other moves, until we find a cut-off */
    best_score = score;
    hash_move = move;
-   while (alpha < beta && (move = movelist[depth].next_move())) {
+   while (alpha < beta && (move = next_staged_move(depth, &picker))) {
+      legal_moves++;
       if (multipv > 1 && depth == 0 && exclude.contains(move)) continue;
       bool in_check = board.check();
 
@@ -838,8 +1132,14 @@ int search(int alpha, int beta, int draft, int depth)
       }
       if (draft < 3 && is_pickup_move(move)) continue;
 
+      move_legality_t legality = movegen.test_move_legality(&lf, &board, move);
+      if (legality == MOVE_ILLEGAL) {
+         legal_moves--;
+         continue;
+      }
+      prefetch_move(move);
       playmove(move);
-      if (player_in_check(me)) {
+      if (legality == MOVE_LEGALITY_UNKNOWN && player_in_check(me)) {
          legal_moves--;
          takeback();
          continue;
@@ -916,7 +1216,6 @@ int search(int alpha, int beta, int draft, int depth)
          update_history(movelist[depth].move[n], -draft * draft);
    }
 
-no_moves:
    /* If there are no legal moves, the game is over */
    if (legal_moves == 0) {
       assert(depth > 0);
@@ -1219,10 +1518,9 @@ void score_static_moves(movelist_t *movelist)
 
       /* Push passed pawns */
       if (pt.pawn_pieces & (1<<piece)) {
-         pawn_structure_t<kind> ps;
-         calculate_pawn_structure(&ps);
+         const pawn_structure_t<kind> *ps = probe_pawn_structure();
 
-         if (!is_drop_move(move) && ps.passed.test(get_move_from(move)))
+         if (!is_drop_move(move) && ps->passed.test(get_move_from(move)))
             movelist->score[n] += 50;
       }
 
@@ -1259,6 +1557,170 @@ void score_static_moves(movelist_t *movelist)
    //movelist->show();
 }
 
+/* Parallel search.
+ * Helper threads search the same position as the master thread, and share
+ * information with it only through the transposition table ("lazy SMP").
+ * Odd and even helpers start at different depths so they do not all search
+ * the same tree in lock-step.
+ */
+void destroy_helpers()
+{
+   for (int n=0; n<num_helpers; n++)
+      delete helper[n];
+   num_helpers = 0;
+}
+
+game_template_t<kind> *create_helper(int id)
+{
+   game_template_t<kind> *game = new game_template_t<kind>();
+
+   game->helper_id = id;
+   game->output_iteration = NULL;
+   game->uci_output       = NULL;
+   game->xboard_output    = NULL;
+   game->error_output     = NULL;
+
+   /* The move generator tables are shared with the master; they are never
+    * changed during the lifetime of a helper. Only the pointers to them are
+    * copied, and the helper does not free them.
+    */
+   game->movegen = movegen;
+   game->files = files;
+   game->ranks = ranks;
+   game->holdsize = holdsize;
+   game->virtual_files = virtual_files;
+   game->virtual_ranks = virtual_ranks;
+   game->top_left = top_left;
+
+   return game;
+}
+
+/* Copy the current position, including the game history needed for
+ * repetition detection, to a helper.
+ */
+void copy_search_position(const game_template_t<kind> *master)
+{
+   pt = master->pt;
+   geometry = master->geometry;
+   board = master->board;
+   board.piece_types = &pt;
+   board.geometry = &geometry;
+   root_board = master->root_board;
+   root_board.piece_types = &pt;
+   root_board.geometry = &geometry;
+   allocate_continuation_history();
+
+   /* The old contents are overwritten below, so there is no need to keep
+    * them when growing the lists.
+    */
+   if (max_moves < master->max_moves) {
+      max_moves = master->max_moves;
+      free(move_list);
+      free(ui);
+      move_list = (move_t *)malloc(max_moves * sizeof *move_list);
+      ui = (unmake_info_t<kind> *)malloc(max_moves * sizeof *ui);
+   }
+   std::copy(master->move_list, master->move_list + master->moves_played, move_list);
+   std::copy(master->ui, master->ui + master->moves_played, ui);
+   memcpy(repetition_hash_table, master->repetition_hash_table, sizeof repetition_hash_table);
+   memcpy(board_repetition_hash_table, master->board_repetition_hash_table, sizeof board_repetition_hash_table);
+   moves_played = master->moves_played;
+   start_move_count = master->start_move_count;
+
+   mate_score = master->mate_score;
+   stale_score = master->stale_score;
+   rep_score = master->rep_score;
+   bare_king_score = master->bare_king_score;
+   no_piece_score = master->no_piece_score;
+   flag_score = master->flag_score;
+   perpetual = master->perpetual;
+   check_score = master->check_score;
+   check_limit = master->check_limit;
+   fifty_limit = master->fifty_limit;
+   fifty_scale_limit = master->fifty_scale_limit;
+   option_ms = master->option_ms;
+   qsearch_hash = master->qsearch_hash;
+   random_key = master->random_key;
+   random_amplitude = master->random_amplitude;
+   random_ok = master->random_ok;
+   level = master->level;
+   multipv = 1;
+
+   transposition_table = master->transposition_table;
+   eval_table = master->eval_table;
+   cycle_key = master->cycle_key;
+   cycle_move = master->cycle_move;
+   cycle_mask = master->cycle_mask;
+
+   memset(&clock, 0, sizeof clock);
+   clock.root_moves_played = master->clock.root_moves_played;
+   branches_pruned = 0;
+   eval_count = 0;
+   lazy_eval_count = 0;
+   lazy_eval_errors = 0;
+}
+
+void helper_search(void)
+{
+   int e = board.check();
+
+   for (int depth = 1 + (helper_id & 1); depth <= helper_max_depth; depth++) {
+      search(-LEGALWIN, LEGALWIN, depth + e, 0);
+      if (abort_search) break;
+   }
+}
+
+static void helper_search_job(void *data, int thread_id)
+{
+   game_template_t<kind> *master = (game_template_t<kind> *)data;
+
+   master->helper[thread_id-1]->helper_search();
+}
+
+void start_helpers(int max_depth)
+{
+   int threads = get_number_of_threads();
+
+   if (threads <= 1 || abort_search) return;
+
+   if (num_helpers > threads-1)
+      destroy_helpers();
+
+   while (num_helpers < threads-1) {
+      helper[num_helpers] = create_helper(num_helpers+1);
+      num_helpers++;
+   }
+
+   for (int n=0; n<num_helpers; n++) {
+      helper[n]->copy_search_position(this);
+      helper[n]->helper_max_depth = max_depth;
+   }
+
+   start_helper_threads(helper_search_job, this);
+}
+
+/* Stop all helper threads and add their node counts to our own. */
+void stop_helpers(void)
+{
+   if (num_helpers == 0) return;
+
+   bool aborted = abort_search;
+   abort_search = true;
+   wait_helper_threads();
+   abort_search = aborted;
+
+   for (int n=0; n<num_helpers; n++) {
+      clock.nodes_searched += helper[n]->clock.nodes_searched;
+      helper[n]->clock.nodes_searched = 0;
+      eval_count += helper[n]->eval_count;
+      lazy_eval_count += helper[n]->lazy_eval_count;
+      lazy_eval_errors += helper[n]->lazy_eval_errors;
+      helper[n]->eval_count = 0;
+      helper[n]->lazy_eval_count = 0;
+      helper[n]->lazy_eval_errors = 0;
+   }
+}
+
 play_state_t think(int max_depth)
 {
    play_state_t state;
@@ -1272,6 +1734,9 @@ play_state_t think(int max_depth)
    clock.nodes_searched = 0;
 
    branches_pruned = 0;
+   eval_count = 0;
+   lazy_eval_count = 0;
+   lazy_eval_errors = 0;
    abort_search = false;
 
    /* Start the clock */
@@ -1315,9 +1780,8 @@ play_state_t think(int max_depth)
    if (!analysing)
       prepare_hashtable_search(transposition_table);
 
-   int hash_depth, hash_score;
-   uint32_t hash_flag;
-   retrieve_table(transposition_table, board.hash, &hash_depth, &hash_score, &hash_flag, &best_move[0]);
+   allocate_continuation_history();
+   initialise_cycle_table();
 
    xb("# Begin iterative deepening loop for position \"%s\"\n", make_fen_string());
 
@@ -1341,9 +1805,12 @@ play_state_t think(int max_depth)
       xb("\n");
    }
    move_t move = best_move[0];
+
+   /* Start the helper threads, if we have any */
+   start_helpers(max_depth);
+
    if (!abort_search)
    for (depth=2; depth<=max_depth; depth++) {
-      scale_history();
       movelist.rewind();
       exclude.clear();
 
@@ -1434,6 +1901,8 @@ play_state_t think(int max_depth)
          break;
    }
 
+   stop_helpers();
+
    while (analysing && !abort_search)
       check_clock();
 
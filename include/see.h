@@ -32,6 +32,11 @@ struct {
    int score;
 } see_cache[0xFFFF + 1 + 8];
 
+void prefetch_see_cache(uint64_t key)
+{
+   prefetch(see_cache + (key & 0xFFFF));
+}
+
 bool probe_see_cache(move_t move, int *score)
 {
    int index = board.hash & 0xFFFF;
@@ -176,3 +181,85 @@ int see(move_t move)
    return score[0];
 }
 
+
+/* Threshold version of the static exchange evaluation: returns true if the
+ * exchange started by the move gains at least "threshold" centipawns.
+ * Uses the same exchange sequence as see(), but stops as soon as the result
+ * is known, so it is much cheaper when only the sign is needed.
+ * The (exact) result is not stored in the SEE cache.
+ */
+bool see_ge(move_t move, int threshold)
+{
+   side_t side    = board.side_to_move;
+   int square     = get_move_to(move);
+   int piece      = get_move_piece(move);
+   bitboard_t<kind> attackers, hidden_attackers;
+   bitboard_t<kind> xray_update;
+   bitboard_t<kind> own;
+   bitboard_t<kind> mask = bitboard_t<kind>::board_all;
+   int score;
+
+   if (probe_see_cache(move, &score))
+      return score >= threshold;
+
+   /* The early exits assume that losing a piece is never a gain */
+   if (pt.negative_piece_values)
+      return see(move) >= threshold;
+
+   /* Balance after the move, if the piece is not recaptured. If that is
+    * not enough, we can stop here.
+    */
+   int balance = move_value(move, side) - threshold;
+   if (balance < 0) return false;
+
+   /* Balance if the piece is recaptured for free. If that is still enough
+    * there is nothing more to do.
+    */
+   balance = pt.piece_value[piece] - balance;
+   if (balance <= 0) return true;
+
+   if (is_capture_move(move))
+      mask.reset(get_move_capture_square(move));
+   if (!is_drop_move(move))
+      mask.reset(get_move_from(move));
+
+   for (int n = 0; n<pt.num_piece_types; n++) {
+      if (is_slider(pt.piece_capture_flags[n]) ||
+          is_hopper(pt.piece_capture_flags[n]) ||
+          is_stepper(pt.piece_capture_flags[n]))
+         xray_update |= board.bbp[n];
+   }
+   xray_update &= movegen.super_slider[square] | movegen.super_stepper[square];
+
+   attackers = movegen.get_all_attackers(&board, mask, square);
+   hidden_attackers = xray_update;
+   hidden_attackers &= ~attackers;
+
+   /* "result" is true if the side that made the move is ahead, assuming
+    * the side to move stops capturing. "balance" is the amount the side to
+    * move has to win back for the result to flip.
+    */
+   bool result = true;
+   while (true) {
+      side = next_side[side];
+      own = attackers & board.bbc[side];
+      if (own.is_empty()) break;
+
+      int from = board.locate_least_valued_piece(own);
+      int piece = board.get_piece(from);
+
+      result = !result;
+      balance = pt.piece_value[piece] - balance;
+      if (balance < (int)result) break;
+
+      attackers.reset(from);
+      mask.reset(from);
+
+      if (xray_update.test(from) && !(hidden_attackers & mask).is_empty()) {
+         attackers = movegen.get_all_attackers(&board, mask, square);
+         hidden_attackers &= ~attackers;
+      }
+   }
+
+   return result;
+}
@@ -0,0 +1,62 @@
+/*  Sjaak, a program for playing chess variants
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SMP_H
+#define SMP_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maximum number of search threads, including the main thread */
+#define MAX_THREADS 64
+
+#ifdef SMP
+#define LOCK_DESCRIPTION "pthread mutexes"
+#else
+#define LOCK_DESCRIPTION "none (single threaded)"
+#endif
+
+/* A job that is run on each of the helper threads. The thread id runs from
+ * 1 to get_number_of_threads()-1; thread 0 is the main thread, which does
+ * not run the job.
+ */
+typedef void (*thread_job_t)(void *data, int thread_id);
+
+/* Start a pool of threads; the number includes the main thread, so
+ * init_threads(1) means no helper threads are started.
+ */
+extern void init_threads(int num_threads);
+extern void kill_threads(void);
+extern int get_number_of_threads(void);
+extern int get_number_of_cores(void);
+
+/* Run job(data, id) on all helper threads, returns immediately */
+extern void start_helper_threads(thread_job_t job, void *data);
+
+/* Wait until all helper threads have finished their current job */
+extern void wait_helper_threads(void);
+
+/* Clear a (large) block of memory, using all threads */
+extern void clear_memory_parallel(void *ptr, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
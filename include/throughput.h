@@ -0,0 +1,185 @@
+/*  Sjaak, a program for playing chess variants
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Throughput of the building blocks of the search, in operations per
+ * second. The operations are timed on a fixed set of positions taken from
+ * random games from the current position, so the numbers can be compared
+ * between versions of the program.
+ */
+#define THROUGHPUT_POSITIONS 64
+#define THROUGHPUT_MAX_PLY   80
+
+/* Simple xorshift generator, so the positions do not depend on (or change)
+ * the state of the random number generator used by the search.
+ */
+static uint64_t throughput_random(uint64_t *state)
+{
+   uint64_t x = *state;
+   x ^= x << 13;
+   x ^= x >> 7;
+   x ^= x << 17;
+   return *state = x;
+}
+
+void measure_throughput(throughput_t *tp, int msec)
+{
+   board_t<kind> *positions = new board_t<kind>[THROUGHPUT_POSITIONS];
+   movelist_t *moves = new movelist_t[THROUGHPUT_POSITIONS];
+   board_t<kind> start_board = board;
+   size_t start_moves_played = moves_played;
+   uint64_t state = 0x2545F4914F6CDD1Dull;
+   uint64_t usec = (uint64_t)msec * 1000;
+   uint64_t t, ops;
+   int n = 0;
+
+   memset(tp, 0, sizeof *tp);
+
+   /* Collect positions */
+   while (n < THROUGHPUT_POSITIONS) {
+      movelist_t *ml = movelist;
+      generate_legal_moves(ml);
+      if (ml->num_moves == 0 || moves_played - start_moves_played >= THROUGHPUT_MAX_PLY) {
+         if (moves_played == start_moves_played) break;
+         while (moves_played > start_moves_played) takeback();
+         continue;
+      }
+
+      positions[n] = board;
+      n++;
+
+      playmove(ml->move[throughput_random(&state) % ml->num_moves]);
+      test_move_game_check();
+   }
+   while (moves_played > start_moves_played) takeback();
+   tp->positions = n;
+   if (n == 0) goto done;
+
+   /* Move generation */
+   t = get_timer();
+   ops = 0;
+   do {
+      for (int k = 0; k<n; k++)
+         movegen.generate_moves(movelist, positions + k, positions[k].side_to_move);
+      ops += n;
+   } while (get_timer() - t < usec);
+   tp->movegen = 1.0e6 * ops / (get_timer() - t);
+
+   /* Legality filter, per pseudo-legal move */
+   for (int k = 0; k<n; k++)
+      movegen.generate_moves(moves + k, positions + k, positions[k].side_to_move);
+   t = get_timer();
+   ops = 0;
+   do {
+      for (int k = 0; k<n; k++) {
+         movelist->clear();
+         while (movelist->max_moves < moves[k].num_moves) movelist->grow();
+         memcpy(movelist->move, moves[k].move, moves[k].num_moves * sizeof *movelist->move);
+         movelist->num_moves = moves[k].num_moves;
+         movegen.filter_legal_moves(movelist, positions + k, positions[k].side_to_move);
+         ops += moves[k].num_moves;
+      }
+   } while (get_timer() - t < usec);
+   tp->legal = 1.0e6 * ops / (get_timer() - t);
+
+   /* Make/unmake, per pseudo-legal move */
+   t = get_timer();
+   ops = 0;
+   do {
+      for (int k = 0; k<n; k++) {
+         board_t<kind> *b = positions + k;
+         unmake_info_t<kind> ui;
+         for (int m = 0; m<moves[k].num_moves; m++) {
+            b->makemove(moves[k].move[m], &ui);
+            b->unmakemove(moves[k].move[m], &ui);
+         }
+         ops += moves[k].num_moves;
+      }
+   } while (get_timer() - t < usec);
+   tp->makemove = 1.0e6 * ops / (get_timer() - t);
+
+   /* Copy/make, per pseudo-legal move: the alternative to unmaking a move
+    * is to make it on a copy of the board and throw the copy away.
+    */
+   t = get_timer();
+   ops = 0;
+   do {
+      for (int k = 0; k<n; k++) {
+         board_t<kind> copy;
+         for (int m = 0; m<moves[k].num_moves; m++) {
+            copy = positions[k];
+            copy.makemove(moves[k].move[m]);
+         }
+         ops += moves[k].num_moves;
+      }
+   } while (get_timer() - t < usec);
+   tp->copymake = 1.0e6 * ops / (get_timer() - t);
+
+   /* Static exchange evaluation of all moves. The SEE cache is cleared
+    * before each pass and not included in the time.
+    */
+   t = 0;
+   ops = 0;
+   do {
+      memset(see_cache, 0, sizeof(see_cache));
+      uint64_t t0 = get_timer();
+      for (int k = 0; k<n; k++) {
+         board = positions[k];
+         for (int m = 0; m<moves[k].num_moves; m++)
+            see(moves[k].move[m]);
+         ops += moves[k].num_moves;
+      }
+      t += get_timer() - t0;
+   } while (t < usec);
+   tp->see = 1.0e6 * ops / (t ? t : 1);
+
+   /* Static evaluation, without the evaluation cache */
+   {
+      eval_hash_table_t *et = eval_table;
+      eval_table = NULL;
+      t = get_timer();
+      ops = 0;
+      do {
+         for (int k = 0; k<n; k++) {
+            board = positions[k];
+            static_evaluation<false>(board.side_to_move);
+         }
+         ops += n;
+      } while (get_timer() - t < usec);
+      tp->eval = 1.0e6 * ops / (get_timer() - t);
+      eval_table = et;
+   }
+
+   /* Transposition table probes, for random keys */
+   if (transposition_table) {
+      int depth, score;
+      unsigned int flags;
+      hash_move_t hash_move;
+      t = get_timer();
+      ops = 0;
+      do {
+         for (int k = 0; k<1024; k++)
+            retrieve_table(transposition_table, throughput_random(&state), &depth, &score, &flags, &hash_move);
+         ops += 1024;
+      } while (get_timer() - t < usec);
+      tp->probe = 1.0e6 * ops / (get_timer() - t);
+   }
+
+done:
+   board = start_board;
+   delete[] positions;
+   delete[] moves;
+}
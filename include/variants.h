@@ -21,11 +21,12 @@
 
 typedef game_t *(*new_variant_game_t)(const char *shortname);
 
+template <typename kind>
 game_t *create_standard_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -40,9 +41,9 @@ game_t *create_standard_game(const char *)
    uint32_t kf = PF_ROYAL;
    uint32_t pf = PF_SET_EP | PF_TAKE_EP;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
-   bitboard_t<uint64_t> pi[2] = {bitboard_t<uint64_t>::board_rank[1], bitboard_t<uint64_t>::board_rank[6]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
+   bitboard_t<kind> pi[2] = {bitboard_t<kind>::board_rank[1], bitboard_t<kind>::board_rank[6]};
    game->add_piece_type(fn, fn, 0,  pz, "",     "Knight", "N,n", "N", 325);
    game->add_piece_type(fb, fb, 0,  pz, "",     "Bishop", "B,b", "B", 325);
    game->add_piece_type(fr, fr, 0,  pz, "",     "Rook",   "R,r", "R", 500);
@@ -66,11 +67,12 @@ game_t *create_standard_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_seirawan_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -87,9 +89,9 @@ game_t *create_seirawan_game(const char *)
    uint32_t kf = PF_ROYAL;
    uint32_t pf = PF_SET_EP | PF_TAKE_EP;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
-   bitboard_t<uint64_t> pi[2] = {bitboard_t<uint64_t>::board_rank[1], bitboard_t<uint64_t>::board_rank[6]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
+   bitboard_t<kind> pi[2] = {bitboard_t<kind>::board_rank[1], bitboard_t<kind>::board_rank[6]};
    game->add_piece_type(fn, fn, 0,  pz, "",       "Knight", "N,n", "N", 325);
    game->add_piece_type(fb, fb, 0,  pz, "",       "Bishop", "B,b", "B", 325);
    game->add_piece_type(fr, fr, 0,  pz, "",       "Rook",   "R,r", "R", 500);
@@ -117,11 +119,12 @@ game_t *create_seirawan_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_crazyhouse_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -136,9 +139,9 @@ game_t *create_crazyhouse_game(const char *)
    uint32_t kf = PF_ROYAL;
    uint32_t pf = PF_SET_EP | PF_TAKE_EP;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
-   bitboard_t<uint64_t> pi[2] = {bitboard_t<uint64_t>::board_rank[1], bitboard_t<uint64_t>::board_rank[6]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
+   bitboard_t<kind> pi[2] = {bitboard_t<kind>::board_rank[1], bitboard_t<kind>::board_rank[6]};
    float m_scale = 0.5f;
    game->add_piece_type(fn, fn, 0,  pz, "",     "Knight", "N,n", "N", int(m_scale*325));
    game->add_piece_type(fb, fb, 0,  pz, "",     "Bishop", "B,b", "B", int(m_scale*325));
@@ -176,11 +179,12 @@ game_t *create_crazyhouse_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_chessgi_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -195,9 +199,9 @@ game_t *create_chessgi_game(const char *)
    uint32_t kf = PF_ROYAL;
    uint32_t pf = PF_SET_EP | PF_TAKE_EP;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
-   bitboard_t<uint64_t> pi[2] = {bitboard_t<uint64_t>::board_rank[1], bitboard_t<uint64_t>::board_rank[6]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
+   bitboard_t<kind> pi[2] = {bitboard_t<kind>::board_rank[1], bitboard_t<kind>::board_rank[6]};
    game->add_piece_type(fn, fn, 0,  pz, "",     "Knight", "N,n", "N", 325);
    game->add_piece_type(fb, fb, 0,  pz, "",     "Bishop", "B,b", "B", 325);
    game->add_piece_type(fr, fr, 0,  pz, "",     "Rook",   "R,r", "R", 500);
@@ -224,11 +228,12 @@ game_t *create_chessgi_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_twilight_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -243,9 +248,9 @@ game_t *create_twilight_game(const char *)
    uint32_t kf = PF_ROYAL;
    uint32_t pf = PF_SET_EP | PF_TAKE_EP;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
-   bitboard_t<uint64_t> pi[2] = {bitboard_t<uint64_t>::board_rank[1], bitboard_t<uint64_t>::board_rank[6]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
+   bitboard_t<kind> pi[2] = {bitboard_t<kind>::board_rank[1], bitboard_t<kind>::board_rank[6]};
    game->add_piece_type(fn, fn, 0,  pz, "",     "Knight", "N,n", "N", 325);
    game->add_piece_type(fb, fb, 0,  pz, "",     "Bishop", "B,b", "B", 325);
    game->add_piece_type(fr, fr, 0,  pz, "",     "Rook",   "R,r", "R", 500);
@@ -271,11 +276,12 @@ game_t *create_twilight_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_shatranj_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -288,8 +294,8 @@ game_t *create_shatranj_game(const char *)
    move_flag_t fc = game->movegen.define_piece_move("step NE, NW");
    uint32_t kf = PF_ROYAL;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
    game->add_piece_type(fn, fn, 0,  pz, "",     "Knight", "N,n", "N", 400);
    game->add_piece_type(fb, fb, 0,  pz, "",     "Bishop", "B,b", "B", 100);
    game->add_piece_type(fr, fr, 0,  pz, "",     "Rook",   "R,r", "R", 800);
@@ -355,11 +361,12 @@ game_t *create_courier_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_berolina_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -374,9 +381,9 @@ game_t *create_berolina_game(const char *)
    uint32_t kf = PF_ROYAL;
    uint32_t pf = PF_SET_EP | PF_TAKE_EP;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
-   bitboard_t<uint64_t> pi[2] = {bitboard_t<uint64_t>::board_rank[1], bitboard_t<uint64_t>::board_rank[6]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
+   bitboard_t<kind> pi[2] = {bitboard_t<kind>::board_rank[1], bitboard_t<kind>::board_rank[6]};
    game->add_piece_type(fn, fn, 0,  pz, "",     "Knight", "N,n", "N", 325);
    game->add_piece_type(fb, fb, 0,  pz, "",     "Bishop", "B,b", "B", 325);
    game->add_piece_type(fr, fr, 0,  pz, "",     "Rook",   "R,r", "R", 500);
@@ -400,11 +407,12 @@ game_t *create_berolina_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_knightmate_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -419,9 +427,9 @@ game_t *create_knightmate_game(const char *)
    uint32_t kf = PF_ROYAL;
    uint32_t pf = PF_SET_EP | PF_TAKE_EP;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
-   bitboard_t<uint64_t> pi[2] = {bitboard_t<uint64_t>::board_rank[1], bitboard_t<uint64_t>::board_rank[6]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
+   bitboard_t<kind> pi[2] = {bitboard_t<kind>::board_rank[1], bitboard_t<kind>::board_rank[6]};
    game->add_piece_type(fk, fk, 0,  pz, "",     "Man",    "M,m", "M", 300);
    game->add_piece_type(fb, fb, 0,  pz, "",     "Bishop", "B,b", "B", 325);
    game->add_piece_type(fr, fr, 0,  pz, "",     "Rook",   "R,r", "R", 450);
@@ -445,11 +453,12 @@ game_t *create_knightmate_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_shatar_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -465,9 +474,9 @@ game_t *create_shatar_game(const char *)
    uint32_t mf = PF_NOMATE | PF_SHAK;
    uint32_t sf = PF_SHAK;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
-   bitboard_t<uint64_t> pi[2] = {bitboard_t<uint64_t>::board_rank[1], bitboard_t<uint64_t>::board_rank[6]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
+   bitboard_t<kind> pi[2] = {bitboard_t<kind>::board_rank[1], bitboard_t<kind>::board_rank[6]};
    game->add_piece_type(fn, fn, mf, pz, "",     "Knight", "N,n", "N", 325);
    game->add_piece_type(fb, fb, 0,  pz, "",     "Bishop", "B,b", "B", 325);
    game->add_piece_type(fr, fr, sf, pz, "",     "Rook",   "R,r", "R", 500);
@@ -487,11 +496,12 @@ game_t *create_shatar_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_spartan_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -514,11 +524,11 @@ game_t *create_spartan_game(const char *)
    move_flag_t fb2 = game->movegen.define_piece_move("leap (2,2)") | fbh;
    uint32_t kf = PF_ROYAL;
 
-   bitboard_t<uint64_t> rank2 = bitboard_t<uint64_t>::board_rank[1];
-   bitboard_t<uint64_t> rank7 = bitboard_t<uint64_t>::board_rank[6];
+   bitboard_t<kind> rank2 = bitboard_t<kind>::board_rank[1];
+   bitboard_t<kind> rank7 = bitboard_t<kind>::board_rank[6];
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
    game->add_piece_type( fn,  fn, 0,  pz, "",     "Knight",     "N,n", "N", 325);
    game->add_piece_type( fb,  fb, 0,  pz, "",     "Bishop",     "B,b", "B", 325);
    game->add_piece_type( fr,  fr, 0,  pz, "",     "Rook",       "R,r", "R", 500);
@@ -551,11 +561,12 @@ game_t *create_spartan_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_super_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -574,9 +585,9 @@ game_t *create_super_game(const char *)
    uint32_t kf = PF_ROYAL;
    uint32_t pf = PF_SET_EP | PF_TAKE_EP;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
-   bitboard_t<uint64_t> pi[2] = {bitboard_t<uint64_t>::board_rank[1], bitboard_t<uint64_t>::board_rank[6]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
+   bitboard_t<kind> pi[2] = {bitboard_t<kind>::board_rank[1], bitboard_t<kind>::board_rank[6]};
    game->add_piece_type(fn, fn, 0,  pz, "",     "Knight", "N,n", "N", 325);
    game->add_piece_type(fb, fb, 0,  pz, "",     "Bishop", "B,b", "B", 325);
    game->add_piece_type(fr, fr, 0,  pz, "",     "Rook",   "R,r", "R", 500);
@@ -1323,9 +1334,10 @@ game_t *create_losalamos_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_pocketknight_game(const char *shortname)
 {
-   game_t *game = create_standard_game(shortname);
+   game_t *game = create_standard_game<kind>(shortname);
 
    if (game) {
       free(game->start_fen);
@@ -1339,11 +1351,12 @@ game_t *create_pocketknight_game(const char *shortname)
    return game;
 }
 
+template <typename kind>
 game_t *create_kingofthehill_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -1358,9 +1371,9 @@ game_t *create_kingofthehill_game(const char *)
    uint32_t kf = PF_ROYAL | PF_CAPTUREFLAG;
    uint32_t pf = PF_SET_EP | PF_TAKE_EP;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
-   bitboard_t<uint64_t> pi[2] = {bitboard_t<uint64_t>::board_rank[1], bitboard_t<uint64_t>::board_rank[6]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
+   bitboard_t<kind> pi[2] = {bitboard_t<kind>::board_rank[1], bitboard_t<kind>::board_rank[6]};
    game->add_piece_type(fn, fn, 0,  pz, "",     "Knight", "N,n", "N", 325);
    game->add_piece_type(fb, fb, 0,  pz, "",     "Bishop", "B,b", "B", 325);
    game->add_piece_type(fr, fr, 0,  pz, "",     "Rook",   "R,r", "R", 500);
@@ -1393,11 +1406,12 @@ game_t *create_kingofthehill_game(const char *)
    return game;
 }
 
+template <typename kind>
 game_t *create_sittuyin_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -1411,9 +1425,9 @@ game_t *create_sittuyin_game(const char *)
    uint32_t kf = PF_ROYAL;
    uint32_t pf = PF_PROMOTEWILD;
 
-   bitboard_t<uint64_t> diag = bitboard_t<uint64_t>::board_diagonal[7] | bitboard_t<uint64_t>::board_antidiagonal[7];
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = { diag & diag.board_homeland[BLACK], diag & diag.board_homeland[WHITE] };
+   bitboard_t<kind> diag = bitboard_t<kind>::board_diagonal[7] | bitboard_t<kind>::board_antidiagonal[7];
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = { diag & diag.board_homeland[BLACK], diag & diag.board_homeland[WHITE] };
             game->add_piece_type(fn, fn, 0,  pz, "",  "Knight", "N,n", "N", 325);
             game->add_piece_type(fs, fs, 0,  pz, "",  "Silver general",  "S,s", "S", 275);
             game->add_piece_type(fm, fm, 0,  pz, "",  "Ferz",   "F,f", "F", 100);
@@ -1427,11 +1441,11 @@ game_t *create_sittuyin_game(const char *)
 
    for (int n = 0; n<game->pt.num_piece_types; n++) {
       if (n == ri) {
-         game->pt.drop_zone[WHITE][n] = bitboard_t<uint64_t>::board_rank[0];
-         game->pt.drop_zone[BLACK][n] = bitboard_t<uint64_t>::board_rank[7];
+         game->pt.drop_zone[WHITE][n] = bitboard_t<kind>::board_rank[0];
+         game->pt.drop_zone[BLACK][n] = bitboard_t<kind>::board_rank[7];
       } else {
-         game->pt.drop_zone[WHITE][n] = bitboard_t<uint64_t>::board_rank[0] | bitboard_t<uint64_t>::board_rank[1] | bitboard_t<uint64_t>::board_rank[2];
-         game->pt.drop_zone[BLACK][n] = bitboard_t<uint64_t>::board_rank[7] | bitboard_t<uint64_t>::board_rank[6] | bitboard_t<uint64_t>::board_rank[5];
+         game->pt.drop_zone[WHITE][n] = bitboard_t<kind>::board_rank[0] | bitboard_t<kind>::board_rank[1] | bitboard_t<kind>::board_rank[2];
+         game->pt.drop_zone[BLACK][n] = bitboard_t<kind>::board_rank[7] | bitboard_t<kind>::board_rank[6] | bitboard_t<kind>::board_rank[5];
       }
       game->pt.optional_promotion_zone[WHITE][n] = game->pt.promotion_zone[WHITE][n];
       game->pt.optional_promotion_zone[BLACK][n] = game->pt.promotion_zone[BLACK][n];
@@ -1457,11 +1471,12 @@ game_t *create_sittuyin_game(const char *)
 }
 
 
+template <typename kind>
 game_t *create_makruk_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -1474,8 +1489,8 @@ game_t *create_makruk_game(const char *)
    move_flag_t fc = game->movegen.define_piece_move("step NE, NW");
    uint32_t kf = PF_ROYAL;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[5], bitboard_t<uint64_t>::board_rank[2]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[5], bitboard_t<kind>::board_rank[2]};
    game->add_piece_type(fn, fn, 0,  pz, "",  "Knight", "N,n", "N", 325);
    game->add_piece_type(fs, fs, 0,  pz, "",  "Silver general",  "S,s", "S", 275);
    game->add_piece_type(fm, fm, 0,  pz, "",  "Met",    "M,m", "M", 150);
@@ -1499,11 +1514,12 @@ game_t *create_makruk_game(const char *)
 }
 
 
+template <typename kind>
 game_t *create_aiwok_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -1516,8 +1532,8 @@ game_t *create_aiwok_game(const char *)
    move_flag_t fc = game->movegen.define_piece_move("step NE, NW");
    uint32_t kf = PF_ROYAL;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[5], bitboard_t<uint64_t>::board_rank[2]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[5], bitboard_t<kind>::board_rank[2]};
    game->add_piece_type(fn, fn, 0,  pz, "",  "Knight", "N,n", "N", 325);
    game->add_piece_type(fs, fs, 0,  pz, "",  "Silver general",  "S,s", "S", 275);
    game->add_piece_type(fa, fa, 0,  pz, "",  "Ai-Wok", "A,a", "A",1050);
@@ -1542,11 +1558,12 @@ game_t *create_aiwok_game(const char *)
 }
 
 
+template <typename kind>
 game_t *create_asean_game(const char *)
 {
    int files = 8;
    int ranks = 8;
-   game_template_t<uint64_t> *game = new game_template_t<uint64_t>;
+   game_template_t<kind> *game = new game_template_t<kind>;
 
    game->set_board_size(files, ranks);
 
@@ -1559,8 +1576,8 @@ game_t *create_asean_game(const char *)
    move_flag_t fc = game->movegen.define_piece_move("step NE, NW");
    uint32_t kf = PF_ROYAL;
 
-   bitboard_t<uint64_t> pz[2];
-   bitboard_t<uint64_t> pp[2] = {bitboard_t<uint64_t>::board_rank[7], bitboard_t<uint64_t>::board_rank[0]};
+   bitboard_t<kind> pz[2];
+   bitboard_t<kind> pp[2] = {bitboard_t<kind>::board_rank[7], bitboard_t<kind>::board_rank[0]};
    game->add_piece_type(fn, fn, 0,  pz, "",     "Knight", "N,n", "N", 325);
    game->add_piece_type(fs, fs, 0,  pz, "",     "Bishop", "B,b", "B", 275);
    game->add_piece_type(fm, fm, 0,  pz, "",     "Queen",  "Q,q", "Q", 150);
@@ -18,6 +18,8 @@
 #include <stdint.h>
 #include "evalhash.h"
 #include "bool.h"
+#include "smp.h"
+#include "prefetch.h"
 
 /* FIXME: tune this */
 #define NUM_BUCKETS 2
@@ -42,18 +44,26 @@ eval_hash_table_t *create_eval_hash_table(size_t nelem)
    eval_hash_table_t *table = calloc(1, sizeof *table);
 
    table->number_of_elements = nelem;
-   table->data = calloc(nelem + NUM_BUCKETS, sizeof *table->data);
+   table->memory_size = (nelem + NUM_BUCKETS) * sizeof *table->data;
+   table->data = large_malloc(table->memory_size, &table->backing, &table->interleaved);
    return table; 
 }
 
 void destroy_eval_hash_table(eval_hash_table_t *table)
 {
    if (table) {
-      free(table->data);
+      large_free(table->data, table->memory_size, table->backing);
       free(table);
    }
 }
 
+void clear_eval_hash_table(eval_hash_table_t *table)
+{
+   if (table && table->dirty)
+      clear_memory_parallel(table->data, table->memory_size);
+   if (table) table->dirty = false;
+}
+
 bool query_eval_table_entry(eval_hash_table_t *table, uint64_t key, int16_t *score)
 {
    size_t index, b;
@@ -116,8 +126,14 @@ void store_eval_hash_entry(eval_hash_table_t *table, uint64_t key, int16_t score
 store:
    data = lock | ((uint16_t)score);
    table->data[index].data = data;
+   if (!table->dirty) table->dirty = true;
 #ifdef DEBUG_EVHASH
    table->data[index].key = key;
 #endif
 }
 
+void prefetch_evaltable(eval_hash_table_t *table, uint64_t key)
+{
+   if (table)
+      prefetch(table->data + map_key_to_index(key, table->number_of_elements));
+}
@@ -23,6 +23,8 @@ uint64_t hold_key[MAX_PIECE_TYPES][2][128];
 uint64_t side_to_move_key;
 uint64_t flag_key[2][8];
 uint64_t en_passant_key[128];
+uint64_t material_key[MAX_PIECE_TYPES][2];
+uint64_t material_hold_key[MAX_PIECE_TYPES][2];
 
 uint64_t genrand64(void)
 {
@@ -52,5 +54,11 @@ void initialise_hash_keys(void)
       for (colour = 0; colour<2; colour++)
          for (square = 0; square<128; square++)
             hold_key[piece][colour][square] = square ? genrand64() : 0;
+
+   for (piece = 0; piece < MAX_PIECE_TYPES; piece++)
+      for (colour = 0; colour<2; colour++) {
+         material_key[piece][colour] = genrand64();
+         material_hold_key[piece][colour] = genrand64();
+      }
 }
 
@@ -14,11 +14,11 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <stdlib.h>
 #include <string.h>
 #include "hashtable.h"
 #include "prefetch.h"
-
-#define HASH_BUCKETS    3
+#include "smp.h"
 
 static inline size_t map_key_to_index(uint64_t key, size_t nelem)
 {
@@ -30,85 +30,153 @@ static inline uint32_t map_key_to_lock(uint64_t key)
    return key >> 32;
 }
 
+/* Round the number of clusters down to a power of 2 */
+static size_t number_of_clusters(size_t nelem)
+{
+   size_t nclusters = 1;
+   while (2*nclusters*HASH_BUCKETS <= nelem)
+      nclusters *= 2;
+   return nclusters;
+}
+
 hash_table_t *create_hash_table(size_t nelem)
 {
    hash_table_t *table;
+   size_t nclusters;
    if (!nelem) return NULL;
 
+   nclusters = number_of_clusters(nelem);
+
+   /* The memory is not cleared explicitly, so that pages are only touched
+    * when they are used. Align clusters with cache lines.
+    */
    table = calloc(1, sizeof *table);
-   table->data = calloc(nelem + HASH_BUCKETS, sizeof *table->data);
-   table->number_of_elements = nelem;
+   table->memory_size = nclusters * sizeof *table->data + HASH_CLUSTER_SIZE;
+   table->memory = large_malloc(table->memory_size, &table->backing, &table->interleaved);
+   table->data = (hash_table_cluster_t *)(((uintptr_t)table->memory + HASH_CLUSTER_SIZE-1) & ~(uintptr_t)(HASH_CLUSTER_SIZE-1));
+   table->number_of_clusters = nclusters;
+   table->number_of_elements = nclusters * HASH_BUCKETS;
    return table;
 }
 
 void destroy_hash_table(hash_table_t *table)
 {
    if (table) {
-      free(table->data);
+      large_free(table->memory, table->memory_size, table->backing);
       free(table);
    }
 }
 
+/* Returns true if the table would not change when re-created for nelem
+ * entries.
+ */
+bool hash_table_has_size(const hash_table_t *table, size_t nelem)
+{
+   if (!table || !nelem) return false;
+   return table->number_of_clusters == number_of_clusters(nelem);
+}
+
+/* Clear the table in place, rather than re-allocating it. */
+void clear_hash_table(hash_table_t *table)
+{
+   if (!table) return;
+
+   if (table->dirty)
+      clear_memory_parallel(table->data, table->number_of_clusters * sizeof *table->data);
+   table->dirty = false;
+   table->generation = 0;
+   table->write_count = 0;
+}
+
 /* Encrypt transposition table entry using the "xor trick" for lockless
  * hashing.
  */
 static void crypt(hash_table_entry_t *hash)
 {
    uint64_t *h;
-   assert(sizeof(hash_table_entry_t) == 3*sizeof(uint64_t));
+   assert(sizeof(hash_table_entry_t) == 2*sizeof(uint64_t));
    h = (uint64_t *)hash;
-   //h[1] ^= h[2];
    h[0] ^= h[1];
 }
 
-//static lock_t hash_lock = 0;
+/* An entry for the same position is only replaced by a result that is at
+ * most this much shallower, unless the new result is exact.
+ */
+#define HASH_KEEP_DEPTH_MARGIN 3
+
+/* Replacement priority of an entry: entries from a previous search are
+ * replaced before entries from the current search, shallow entries before
+ * deep entries.
+ */
+static inline int replace_value(const hash_table_t *table, const hash_table_entry_t *hash)
+{
+   if (hash->generation == 0) return -0x10000;
+   return hash->depth - ((hash->generation != table->generation) ? 0x100 : 0);
+}
+
 void store_table_entry(hash_table_t *table, uint64_t key, int depth, int score, unsigned int flags, move_t best_move)
 {
    hash_table_entry_t *data;
    hash_table_entry_t *worst_data = NULL;
+   hash_table_entry_t hash;
    size_t index, b;
    uint32_t lock;
+   hash_move_t move;
 
    if (!table)
       return;
 
    /* Map the key onto the array index, check if entry is there */
-   index = map_key_to_index(key, table->number_of_elements);
+   index = map_key_to_index(key, table->number_of_clusters);
    lock = map_key_to_lock(key);
-   worst_data = data = table->data + index;
-
-   //acquire_lock(&hash_lock);
+   data = table->data[index].entry;
+   move = compress_hash_move(best_move);
 
    /* Check all buckets */
-   for (b=1; b<HASH_BUCKETS; b++) {
-      hash_table_entry_t hash = data[b];
+   worst_data = data;
+   for (b=0; b<HASH_BUCKETS; b++) {
+      hash = data[b];
       crypt(&hash);
       if (hash.lock == lock) {
+         /* Don't let a much shallower result (say, from the quiescence
+          * search) overwrite a deeper one, but do record its move.
+          */
+         if (!(flags & HASH_TYPE_EXACT) && depth < hash.depth - HASH_KEEP_DEPTH_MARGIN) {
+            if (best_move) hash.best_move = move;
+            hash.generation = table->generation;
+            crypt(&hash);
+            data[b] = hash;
+            if (!table->dirty) table->dirty = true;
+            return;
+         }
          worst_data = data+b;
+
+         /* Keep the old move if we don't have a new one */
+         if (!best_move) move = hash.best_move;
          break;
       }
 
-      if (hash.depth < worst_data->depth ||
-          hash.generation < table->generation ||
-          hash.generation == 0) {
+      if (replace_value(table, data+b) < replace_value(table, worst_data))
          worst_data = data+b;
-      }
    }
    data = worst_data;
 
-   data->lock = lock;
-   data->depth = depth;
-   data->score = score;
-   data->flags = flags;
-   data->best_move = best_move;
-   data->generation = table->generation;
-   crypt(data);
+   hash.lock = lock;
+   hash.depth = depth;
+   hash.score = score;
+   hash.flags = flags;
+   hash.best_move = move;
+   hash.generation = table->generation;
+   hash.padding = 0;
+   crypt(&hash);
+   *data = hash;
    table->write_count++;
-   //release_lock(&hash_lock);
+   if (!table->dirty) table->dirty = true;
 }
 
-bool retrieve_table(hash_table_t *table, uint64_t key, int *depth, int *score, unsigned int *flags, move_t *best_move)
+bool retrieve_table(hash_table_t *table, uint64_t key, int *depth, int *score, unsigned int *flags, hash_move_t *best_move)
 {
+   hash_table_entry_t *data;
    size_t index, b;
    uint32_t lock;
 
@@ -116,35 +184,30 @@ bool retrieve_table(hash_table_t *table, uint64_t key, int *depth, int *score, u
       return false;
 
    /* Map the key onto the array index, check if entry is there */
-   index = map_key_to_index(key, table->number_of_elements);
+   index = map_key_to_index(key, table->number_of_clusters);
    lock = map_key_to_lock(key);
-
-   //acquire_lock(&hash_lock);
+   data = table->data[index].entry;
 
    /* Check all buckets */
-   b = 0;
    for (b = 0; b<HASH_BUCKETS; b++) {
-      hash_table_entry_t hash = table->data[index+b];
+      hash_table_entry_t hash = data[b];
       crypt(&hash);
       if (hash.lock == lock) {
-         hash.generation = table->generation;
-
          *depth = hash.depth;
          *score = hash.score;
          *flags = hash.flags;
          *best_move = hash.best_move;
-         //release_lock(&hash_lock);
          return true;
       }
    }
 
-   //release_lock(&hash_lock);
    return false;
 }
 
 void prepare_hashtable_search(hash_table_t *table)
 {
    table->generation++;
+   if (table->generation == 0) table->generation++;
    table->write_count = 0;
 }
 
@@ -153,23 +216,25 @@ void prefetch_hashtable(hash_table_t *table, uint64_t key)
    size_t index;
 
    if (table) {
-      index = map_key_to_index(key, table->number_of_elements);
+      index = map_key_to_index(key, table->number_of_clusters);
       prefetch(table->data+index);
    }
 }
 
 int count_unused_table_entries(hash_table_t *table)
 {
-   size_t n;
+   size_t n, b;
    int count;
    if (!table)
       return 0;
 
    count = 0;
 
-   for (n=0; n<table->number_of_elements; n++) {
-      if (table->data[n].generation == 0)
-         count++;
+   for (n=0; n<table->number_of_clusters; n++) {
+      for (b=0; b<HASH_BUCKETS; b++) {
+         if (table->data[n].entry[b].generation == 0)
+            count++;
+      }
    }
 
    return count;
@@ -0,0 +1,97 @@
+/*  Sjaak, a program for playing chess variants
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "perfthash.h"
+#include "bool.h"
+
+/* Each key maps to two entries: the first is replaced only by entries of
+ * the same or a larger depth, the second is always replaced.
+ */
+#define NUM_BUCKETS 2
+
+static inline size_t map_key_to_index(uint64_t key, size_t nelem)
+{
+   return key & (nelem - 1) & ~(size_t)(NUM_BUCKETS - 1);
+}
+
+static inline uint64_t make_data(int depth, uint64_t nodes)
+{
+   return (nodes << 8) | (uint8_t)depth;
+}
+
+perft_hash_table_t *create_perft_hash_table(size_t nelem)
+{
+   perft_hash_table_t *table = calloc(1, sizeof *table);
+
+   table->number_of_elements = nelem;
+   table->memory_size = nelem * sizeof *table->data;
+   table->data = large_malloc(table->memory_size, &table->backing, &table->interleaved);
+   return table;
+}
+
+void destroy_perft_hash_table(perft_hash_table_t *table)
+{
+   if (table) {
+      large_free(table->data, table->memory_size, table->backing);
+      free(table);
+   }
+}
+
+/* Clear the table in place, rather than re-allocating it. */
+void clear_perft_hash_table(perft_hash_table_t *table)
+{
+   if (table)
+      memset(table->data, 0, table->memory_size);
+}
+
+bool query_perft_table_entry(perft_hash_table_t *table, uint64_t key, int depth, uint64_t *nodes)
+{
+   size_t index, b;
+
+   if (!table)
+      return false;
+
+   index = map_key_to_index(key, table->number_of_elements);
+   for (b=0; b<NUM_BUCKETS; b++) {
+      perft_hash_t h = table->data[index + b];
+      if ((h.lock ^ h.data) == key && (uint8_t)h.data == (uint8_t)depth) {
+         *nodes = h.data >> 8;
+         return true;
+      }
+   }
+   return false;
+}
+
+void store_perft_hash_entry(perft_hash_table_t *table, uint64_t key, int depth, uint64_t nodes)
+{
+   size_t index;
+   uint64_t data;
+
+   if (!table)
+      return;
+
+   index = map_key_to_index(key, table->number_of_elements);
+   data = make_data(depth, nodes);
+
+   if (depth < (int)(uint8_t)table->data[index].data)
+      index++;
+
+   table->data[index].lock = key ^ data;
+   table->data[index].data = data;
+}
@@ -0,0 +1,37 @@
+/*  Sjaak, a program for playing chess variants
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cpu.h"
+
+#if defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
+#include <intrin.h>
+#endif
+
+bool cpu_has_bmi2(void)
+{
+#if (defined __GNUC__ || defined __clang__) && (defined __x86_64__ || defined __i386__)
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("bmi2") != 0;
+#elif defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7) return false;
+   __cpuidex(info, 7, 0);
+   return (info[1] & (1 << 8)) != 0;
+#else
+   return false;
+#endif
+}
@@ -0,0 +1,168 @@
+/*  Sjaak, a program for playing chess variants
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "large_malloc.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define HAVE_MMAP
+#endif
+
+/* Only bother with huge pages and mmap for blocks of at least this size */
+#define HUGE_PAGE_SIZE  (2 << 20)
+
+/* Memory policy for mbind(2); we call the system call directly rather than
+ * depend on libnuma.
+ */
+#define MPOL_INTERLEAVE 3
+
+bool large_malloc_use_hugetlb = false;
+bool large_malloc_interleave = true;
+
+static int numa_nodes = -1;
+
+int get_number_of_numa_nodes(void)
+{
+   if (numa_nodes < 0) {
+      numa_nodes = 1;
+#ifdef __linux__
+      /* The online file lists node ranges, "0" or "0-1" or "0,2-3" */
+      FILE *f = fopen("/sys/devices/system/node/online", "r");
+      if (f) {
+         int first, last, count = 0;
+         char c;
+         while (fscanf(f, "%d", &first) == 1) {
+            last = first;
+            if (fscanf(f, "%c", &c) == 1 && c == '-') {
+               if (fscanf(f, "%d", &last) != 1) last = first;
+               if (fscanf(f, "%c", &c) != 1) c = 0;
+            }
+            count += last - first + 1;
+            if (c != ',') break;
+         }
+         fclose(f);
+         if (count > 0) numa_nodes = count;
+      }
+#endif
+   }
+
+   return numa_nodes;
+}
+
+#ifdef HAVE_MMAP
+static size_t round_to_huge_page(size_t size)
+{
+   return (size + HUGE_PAGE_SIZE-1) & ~(size_t)(HUGE_PAGE_SIZE-1);
+}
+
+static bool interleave_pages(void *ptr, size_t size)
+{
+#if defined SYS_mbind
+   unsigned long mask[4] = { 0 };
+   int nodes = get_number_of_numa_nodes();
+   int n;
+
+   if (nodes <= 1) return false;
+   if (nodes > (int)(8*sizeof mask)) nodes = 8*sizeof mask;
+   for (n=0; n<nodes; n++)
+      mask[n / (8*sizeof *mask)] |= 1ul << (n % (8*sizeof *mask));
+
+   return syscall(SYS_mbind, ptr, size, MPOL_INTERLEAVE, mask, (unsigned long)(8*sizeof mask), 0) == 0;
+#else
+   (void)ptr;
+   (void)size;
+   return false;
+#endif
+}
+#endif
+
+void *large_malloc(size_t size, large_malloc_backing_t *backing, bool *interleaved)
+{
+   void *ptr;
+
+   *interleaved = false;
+
+#ifdef HAVE_MMAP
+   if (size >= HUGE_PAGE_SIZE) {
+      size_t mapsize = round_to_huge_page(size);
+
+      ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+      if (large_malloc_use_hugetlb) {
+         ptr = mmap(NULL, mapsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+         *backing = LARGE_MALLOC_HUGETLB;
+      }
+#endif
+      if (ptr == MAP_FAILED) {
+         ptr = mmap(NULL, mapsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+         *backing = LARGE_MALLOC_MMAP;
+#ifdef MADV_HUGEPAGE
+         if (ptr != MAP_FAILED && madvise(ptr, mapsize, MADV_HUGEPAGE) == 0)
+            *backing = LARGE_MALLOC_THP;
+#endif
+      }
+
+      if (ptr != MAP_FAILED) {
+         /* Pages have not been touched yet, so we can still decide where
+          * they will live. If we don't interleave, they are placed on the
+          * node of the thread that first writes to them.
+          */
+         if (large_malloc_interleave)
+            *interleaved = interleave_pages(ptr, mapsize);
+         return ptr;
+      }
+   }
+#endif
+
+   *backing = LARGE_MALLOC_CALLOC;
+   return calloc(size, 1);
+}
+
+void large_free(void *ptr, size_t size, large_malloc_backing_t backing)
+{
+   if (!ptr) return;
+
+#ifdef HAVE_MMAP
+   if (backing != LARGE_MALLOC_CALLOC) {
+      munmap(ptr, round_to_huge_page(size));
+      return;
+   }
+#else
+   (void)size;
+#endif
+
+   free(ptr);
+}
+
+const char *large_malloc_backing_name(large_malloc_backing_t backing)
+{
+   switch (backing) {
+      case LARGE_MALLOC_CALLOC:
+         return "calloc";
+      case LARGE_MALLOC_MMAP:
+         return "mmap (normal pages)";
+      case LARGE_MALLOC_THP:
+         return "mmap (transparent huge pages)";
+      case LARGE_MALLOC_HUGETLB:
+         return "mmap (explicit huge pages)";
+   }
+   return "unknown";
+}
@@ -0,0 +1,241 @@
+/*  Sjaak, a program for playing chess variants
+ *  Copyright (C) 2011, 2014  Evert Glebbeek
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "bool.h"
+#include "smp.h"
+
+#if defined _WIN32 || defined _WIN64
+#define WINDOWS
+#endif
+
+#if defined __unix__ || defined __APPLE__
+#define UNIX
+#endif
+
+#ifdef WINDOWS
+#undef DATADIR
+#include <windows.h>
+#endif
+
+#ifdef UNIX
+#include <unistd.h>
+#endif
+
+#ifdef SMP
+#include <pthread.h>
+
+/* Helper threads need a reasonable amount of stack space: the search is
+ * recursive and keeps some temporary move lists on the stack.
+ */
+#define THREAD_STACK_SIZE (8 << 20)
+
+static int num_threads = 1;
+static pthread_t thread[MAX_THREADS];
+
+/* The thread pool is controlled through a single lock. Helpers sleep on
+ * start_cond until the job counter changes, the main thread sleeps on
+ * done_cond until all helpers have finished their job.
+ */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond  = PTHREAD_COND_INITIALIZER;
+static thread_job_t current_job = NULL;
+static void *current_data = NULL;
+static unsigned int job_count = 0;
+static int busy_threads = 0;
+static bool quit_threads = false;
+
+static void *thread_main(void *arg)
+{
+   int id = (int)(intptr_t)arg;
+   unsigned int jobs_seen;
+
+   pthread_mutex_lock(&pool_lock);
+   jobs_seen = job_count;
+   while (true) {
+      while (!quit_threads && jobs_seen == job_count)
+         pthread_cond_wait(&start_cond, &pool_lock);
+      if (quit_threads) break;
+
+      jobs_seen = job_count;
+      thread_job_t job = current_job;
+      void *data = current_data;
+      pthread_mutex_unlock(&pool_lock);
+
+      job(data, id);
+
+      pthread_mutex_lock(&pool_lock);
+      busy_threads--;
+      if (busy_threads == 0)
+         pthread_cond_broadcast(&done_cond);
+   }
+   pthread_mutex_unlock(&pool_lock);
+
+   return NULL;
+}
+
+void init_threads(int threads)
+{
+   pthread_attr_t attr;
+
+   kill_threads();
+
+   if (threads > MAX_THREADS) threads = MAX_THREADS;
+   if (threads < 1) threads = 1;
+
+   pthread_attr_init(&attr);
+   pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
+
+   /* Hold the lock while the threads are created, so they all see the same
+    * job counter.
+    */
+   pthread_mutex_lock(&pool_lock);
+   for (num_threads = 1; num_threads < threads; num_threads++) {
+      if (pthread_create(&thread[num_threads], &attr, thread_main, (void *)(intptr_t)num_threads) != 0)
+         break;
+   }
+   pthread_mutex_unlock(&pool_lock);
+
+   pthread_attr_destroy(&attr);
+}
+
+void kill_threads(void)
+{
+   if (num_threads <= 1) return;
+
+   wait_helper_threads();
+
+   pthread_mutex_lock(&pool_lock);
+   quit_threads = true;
+   pthread_cond_broadcast(&start_cond);
+   pthread_mutex_unlock(&pool_lock);
+
+   for (int n = 1; n<num_threads; n++)
+      pthread_join(thread[n], NULL);
+
+   quit_threads = false;
+   num_threads = 1;
+}
+
+int get_number_of_threads(void)
+{
+   return num_threads;
+}
+
+void start_helper_threads(thread_job_t job, void *data)
+{
+   if (num_threads <= 1) return;
+
+   pthread_mutex_lock(&pool_lock);
+   current_job = job;
+   current_data = data;
+   busy_threads = num_threads - 1;
+   job_count++;
+   pthread_cond_broadcast(&start_cond);
+   pthread_mutex_unlock(&pool_lock);
+}
+
+void wait_helper_threads(void)
+{
+   pthread_mutex_lock(&pool_lock);
+   while (busy_threads)
+      pthread_cond_wait(&done_cond, &pool_lock);
+   pthread_mutex_unlock(&pool_lock);
+}
+
+#else
+
+void init_threads(int threads)
+{
+   (void)threads;
+}
+
+void kill_threads(void)
+{
+}
+
+int get_number_of_threads(void)
+{
+   return 1;
+}
+
+void start_helper_threads(thread_job_t job, void *data)
+{
+   (void)job;
+   (void)data;
+}
+
+void wait_helper_threads(void)
+{
+}
+
+#endif
+
+/* Parallel clear: each thread clears its own slice of the block. Slices are
+ * aligned to pages, so that pages are first touched by the thread that
+ * clears them.
+ */
+#define CLEAR_ALIGN 4096
+static struct {
+   uint8_t *ptr;
+   size_t size;
+   int slices;
+} clear_job;
+
+static void clear_slice(int slice)
+{
+   size_t slice_size = (clear_job.size / clear_job.slices + CLEAR_ALIGN-1) & ~(size_t)(CLEAR_ALIGN-1);
+   size_t start = slice * slice_size;
+   size_t end = start + slice_size;
+
+   if (start >= clear_job.size) return;
+   if (end > clear_job.size) end = clear_job.size;
+   memset(clear_job.ptr + start, 0, end - start);
+}
+
+static void clear_memory_job(void *data, int thread_id)
+{
+   (void)data;
+   clear_slice(thread_id);
+}
+
+void clear_memory_parallel(void *ptr, size_t size)
+{
+   clear_job.ptr = ptr;
+   clear_job.size = size;
+   clear_job.slices = get_number_of_threads();
+
+   start_helper_threads(clear_memory_job, NULL);
+   clear_slice(0);
+   wait_helper_threads();
+}
+
+int get_number_of_cores(void)
+{
+#if defined WINDOWS
+   SYSTEM_INFO sysinfo;
+   GetSystemInfo(&sysinfo);
+   return sysinfo.dwNumberOfProcessors;
+#elif defined _SC_NPROCESSORS_ONLN
+   long n = sysconf(_SC_NPROCESSORS_ONLN);
+   return (n > 0) ? (int)n : 1;
+#else
+   return 1;
+#endif
+}
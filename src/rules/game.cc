@@ -21,4 +21,5 @@ void (*default_xboard_output)(const char *, ...) = NULL;
 void (*default_error_output)(const char *, ...) = printfstderr;
 
 size_t default_hash_size = HASH_TABLE_SIZE;
+slider_backend_t slider_backend = SLIDER_AUTO;
 
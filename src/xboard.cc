@@ -272,11 +272,13 @@ static help_topic_t help_topic[] = {
    { "analyse", "analyse, analyze",
      "  Analyse the current position.\n" },
 
-   { "bench", "test benchmark [depth]",
+   { "bench", "test benchmark [depth] [qs]",
      "  Perform a benchmark test to the specified depth. The returned node-count\n"
      "  can be used as a validation that the program is working correctly while\n"
      "  the reported time can be used as a performance measure on the current\n"
-     "  system.\n" },
+     "  system.\n"
+     "  With 'qs', the benchmark is run with and without the transposition table\n"
+     "  in quiescence search and the difference in nodes and time is reported.\n" },
 
    { "board", "board [on|off]",
      "  Print the current board position, or toggles automatic printing of the\n"
@@ -327,7 +329,9 @@ static help_topic_t help_topic[] = {
    { "memory", "memory [MB]",
      "  Set the (approximate) amount of memory the program can use, in MB. The\n"
      "  actual amount of memory used will be different from this and may be\n"
-     "  slightly larger or smaller.\n" },
+     "  slightly larger or smaller.\n"
+     "  Without an argument, report the size of the hash tables and whether\n"
+     "  they are backed by huge pages.\n" },
 
    { "multipv", "multipv n",
      "  Set the number of full evaluation/variations to find in analysis mode.\n"},
@@ -336,11 +340,13 @@ static help_topic_t help_topic[] = {
      "  Start a new game from the starting position.\n"
      "  In xboard mode the current variant is reset to 'normal'.\n" },
 
-   { "perft", "perft [depth] [print depth]",
+   { "perft", "perft [divide] [depth] [print depth]",
      "  Perform a 'perft' (performance test) on the current position: count all\n"
      "  positions that can result from this position to the specified depth.\n"
      "  If 'print depth' is specified then the total will be sub-divided per move\n"
-     "  upto 'print depth'\n" },
+     "  upto 'print depth'\n"
+     "  'perft divide' only searches the given depth, with a sub-total per move.\n"
+     "  The root moves are divided over all threads (see 'cores').\n" },
 
    { "ponder", "ponder [on|off]",
      "  Switches ponder mode on or off (Sjaak will think while it is not on move)\n" }, 
@@ -363,6 +369,13 @@ static help_topic_t help_topic[] = {
    { "rules", NULL,
      "  Summarise the rules of the game and the movement of the pieces in human-radable text.\n" },
 
+   { "sliders", "sliders [auto|tables|magic|pext]",
+     "  Select how slider and hopper moves are generated on boards of up to 64\n"
+     "  squares: rank/file tables, magic bitboards or magic bitboards indexed with\n"
+     "  the PEXT instruction. 'auto' uses PEXT if the program was compiled for\n"
+     "  BMI2, and magic bitboards otherwise.\n"
+     "  Without an argument, report the current setting.\n" },
+
    { "setboard", "setboard FEN",
      "  Setup a position on the board from a FEN string.\n" },
 
@@ -384,10 +397,17 @@ static help_topic_t help_topic[] = {
    { "takeback", "takeback, remove",
      "  Reverses the last two moves in the game, if any.\n" }, 
 
-   { "test", "test [movegen|benchmark [depth]|legal movegen|chase|see <move>|wac|sts]",
+   { "test", "test [movegen|benchmark [depth] [qs]|throughput|legal movegen|sliders|chase [bench [plies]]|see <move>|wac|sts]",
      "  Perform tests on the move generator, the search or various evaluation\n"
      "  components. Can also run a number of build-in test suites.\n" },
 
+   { "throughput", "test throughput [csv|json] [msec] [variants]",
+     "  Measure the throughput (operations per second) of move generation, the\n"
+     "  legality filter, make/unmake, copy/make, SEE, static evaluation and\n"
+     "  transposition table probes, for each of the listed variants, or for all\n"
+     "  known variants. Each operation is timed for 'msec' milliseconds (default\n"
+     "  100). The results are printed as CSV (default) or JSON.\n" },
+
    { "time", "time csec",
      "  Set the remaining time on the engine's clock, in centi-seconds.\n" },
 
@@ -484,6 +504,8 @@ static struct {
    { "Claim repetitions",                                   "repetition_claim",         &repetition_claim,         repetition_claim,         false, false },
    { "Send O-O/O-O-O for castling",                         "castle_oo",                &castle_oo,                castle_oo,                false, false },
    { "Remember evaluation parameter file",                  "remember_eval_file",       &remember_eval_file,       remember_eval_file,       false, false },
+   { "Use huge pages (MAP_HUGETLB)",                        "use_hugetlb",              &large_malloc_use_hugetlb, large_malloc_use_hugetlb, false, false },
+   { "Interleave memory over NUMA nodes",                   "numa_interleave",          &large_malloc_interleave,  large_malloc_interleave,  false, false },
    { NULL, NULL, NULL, false, false, false },
 };
 
@@ -697,32 +719,42 @@ struct variant_t {
    int files, ranks, holdings;
    const char *name;
    new_variant_game_t create;
+   new_variant_game_t create_fixed;    /* With the board geometry fixed at compile time, if available */
 };
 
+/* Creators for variants on an 8x8 board, for the generic 64-bit game and,
+ * if it is compiled in, for the game with the geometry fixed to 8x8.
+ */
+#ifdef HAVE_FIXED8X8
+#define CREATE_8X8(create) create<uint64_t>, create<uint64_8x8_t>
+#else
+#define CREATE_8X8(create) create<uint64_t>, NULL
+#endif
+
 int num_games = 0;
 const char *variant_name = NULL;
 static variant_t standard_variants[] = {
-   {  8,  8, 0, "chess",         create_standard_game },
-   {  8,  8, 0, "seirawan",      create_seirawan_game },
-   {  8,  8, 0, "shatar",        create_shatar_game },
-   {  8,  8, 0, "makruk",        create_makruk_game },
-   {  8,  8, 0, "shatranj",      create_shatranj_game },
-   {  8,  8, 6, "sittuyin",      create_sittuyin_game },
+   {  8,  8, 0, "chess",         CREATE_8X8(create_standard_game) },
+   {  8,  8, 0, "seirawan",      CREATE_8X8(create_seirawan_game) },
+   {  8,  8, 0, "shatar",        CREATE_8X8(create_shatar_game) },
+   {  8,  8, 0, "makruk",        CREATE_8X8(create_makruk_game) },
+   {  8,  8, 0, "shatranj",      CREATE_8X8(create_shatranj_game) },
+   {  8,  8, 6, "sittuyin",      CREATE_8X8(create_sittuyin_game) },
 
-   {  8,  8, 6, "crazyhouse",    create_crazyhouse_game },
-   {  8,  8, 6, "chessgi",       create_chessgi_game },
-   //{  8,  8, 6, "twilight",      create_twilight_game },
+   {  8,  8, 6, "crazyhouse",    CREATE_8X8(create_crazyhouse_game) },
+   {  8,  8, 6, "chessgi",       CREATE_8X8(create_chessgi_game) },
+   //{  8,  8, 6, "twilight",      CREATE_8X8(create_twilight_game) },
 
-   {  8,  8, 0, "asean",         create_asean_game },
-   {  8,  8, 0, "ai-wok",        create_aiwok_game },
+   {  8,  8, 0, "asean",         CREATE_8X8(create_asean_game) },
+   {  8,  8, 0, "ai-wok",        CREATE_8X8(create_aiwok_game) },
 
-   {  8,  8, 0, "super",         create_super_game },
+   {  8,  8, 0, "super",         CREATE_8X8(create_super_game) },
 
-   {  8,  8, 0, "spartan",       create_spartan_game },
-   {  8,  8, 1, "pocketknight",  create_pocketknight_game },
-   {  8,  8, 0, "kingofthehill", create_kingofthehill_game },
-   {  8,  8, 0, "knightmate",    create_knightmate_game },
-   {  8,  8, 0, "berolina",      create_berolina_game },
+   {  8,  8, 0, "spartan",       CREATE_8X8(create_spartan_game) },
+   {  8,  8, 1, "pocketknight",  CREATE_8X8(create_pocketknight_game) },
+   {  8,  8, 0, "kingofthehill", CREATE_8X8(create_kingofthehill_game) },
+   {  8,  8, 0, "knightmate",    CREATE_8X8(create_knightmate_game) },
+   {  8,  8, 0, "berolina",      CREATE_8X8(create_berolina_game) },
 
    {  6,  6, 0, "losalamos",     create_losalamos_game },
    {  5,  5, 0, "micro",         create_micro_game },
@@ -799,8 +831,11 @@ game_t *create_variant_game(const char *variant_name, int recurse = 0)
    }
 
    for (int n=0; n<num_standard_variants; n++) {
-      if (streq(variant_name, standard_variants[n].name))
+      if (streq(variant_name, standard_variants[n].name)) {
+         if (standard_variants[n].create_fixed)
+            return standard_variants[n].create_fixed(standard_variants[n].name);
          return standard_variants[n].create(standard_variants[n].name);
+      }
    }
 
    int num_alias = sizeof aliases / sizeof *aliases;
@@ -814,6 +849,19 @@ game_t *create_variant_game(const char *variant_name, int recurse = 0)
    return NULL;
 }
 
+/* Replace the current game by a new one, handing over the hash tables so
+ * they do not need to be allocated again.
+ */
+static game_t *replace_variant_game(game_t *old_game, const char *variant_name)
+{
+   game_t *game = create_variant_game(variant_name);
+   if (old_game) {
+      if (game) game->take_hash_tables(old_game);
+      delete old_game;
+   }
+   return game;
+}
+
 /* Play a sequence of moves from the initial position */
 bool input_move(game_t *game, char *move_str)
 {
@@ -1255,37 +1303,6 @@ static bool keyboard_input_analyse(game_t *game)
    return restart;
 }
 
-static uint64_t perft(game_t *game, int depth, int root, bool legal = false)
-{
-   movelist_t *movelist = game->movelist + depth;
-   side_t me = game->get_side_to_move();
-   uint64_t nodes = 0;
-   int n;
-
-   if (depth == 0) return 1;
-
-   /* Check if previous move left the player in check */
-   if (legal)
-      game->generate_legal_moves(movelist);
-   else
-      game->generate_moves(movelist);
-
-   for (n=0; n<movelist->num_moves; n++) {
-      uint64_t count = 0;
-      game->playmove(movelist->move[n]);
-      if (legal || !game->player_in_check(me)) {   /* Don't count illegal moves */
-         game->test_move_game_check();
-         count = perft(game, depth-1, root - 1);
-      }
-      nodes += count;
-      if (root > 0)
-         printf("%8s %10" PRIu64 " %10" PRIu64 "\n", move_to_string(movelist->move[n], NULL), count, nodes);
-      game->takeback();
-      if (abort_search) break;
-   }
-   return nodes;
-}
-
 static bool run_movegen_test(const char *name, const char *variant, const position_signature_t *suite, bool legal)
 {
    game_t *game = NULL;
@@ -1298,7 +1315,7 @@ static bool run_movegen_test(const char *name, const char *variant, const positi
       game->setup_fen_position(suite[n].fen);
       printf(".");
       fflush(stdout);
-      nodes = perft(game, suite[n].depth, 0, legal);
+      nodes = game->perft(suite[n].depth, 0, legal);
       if (nodes != suite[n].nodes) {
          printf("\n");
          printf("*** Failed at %s position %d (%s):\n", name, n, suite[n].fen);
@@ -1325,13 +1342,184 @@ static void test_movegen(bool legal = false)
    printf("\nOk.\n");
 }
 
-static uint64_t test_benchmark(int depth)
+/* Compare the slider/hopper backends: the perft tests are run with each
+ * backend, which should give the same results, and the time taken is
+ * reported. Shogi and XiangQi are played on 128-bit boards, where the
+ * backend selects between line gathers and the plain rank/file tables.
+ */
+static void test_sliders(void)
+{
+   slider_backend_t old_backend = slider_backend;
+   slider_backend_t backends[] = { SLIDER_TABLES, SLIDER_MAGIC, SLIDER_PEXT };
+   uint64_t time[3] = { 0, 0, 0 };
+   int n;
+
+   for (n = 0; n<3; n++) {
+      slider_backend_t backend = backends[n];
+      if (resolve_slider_backend(backend) != backend) {
+         printf("%-8s not supported on this machine\n", slider_backend_name(backend));
+         continue;
+      }
+
+      slider_backend = backend;
+      printf("%-8s", slider_backend_name(backend));
+      fflush(stdout);
+
+      uint64_t t = get_timer();
+      bool ok = run_movegen_test("Chess",    "chess",    perftests,          false) &&
+                run_movegen_test("Spartan",  "spartan",  spartan_perftests,  false) &&
+                run_movegen_test("Seirawan", "seirawan", seirawan_perftests, false) &&
+                run_movegen_test("Sittuyin", "sittuyin", sittuyin_perftests, false) &&
+                run_movegen_test("Shogi",    "shogi",    shogi_perftests,    false) &&
+                run_movegen_test("XiangQi",  "xiangqi",  xiangqi_perftests,  false);
+      time[n] = get_timer() - t;
+
+      if (!ok) break;
+      printf(" %6.2f s", time[n] / 1000000.0);
+      if (time[0] && n) printf(" (%+.1f%%)", 100.0 * ((double)time[n] - time[0]) / time[0]);
+      printf("\n");
+   }
+
+   slider_backend = old_backend;
+}
+
+/* Time the chase-rule test on the XiangQi test positions. From each
+ * position a number of random reversible moves is played, so the part of
+ * the game that the chase rule has to look at keeps growing, and the chase
+ * rule is tested after each move.
+ */
+static void test_chase_benchmark(int plies)
+{
+   uint64_t state = 0x2545F4914F6CDD1Dull;
+   uint64_t total_time = 0;
+   int total_calls = 0;
+   int n = 0;
+
+   while (xiangqi_perftests[n].fen) {
+      game_t *game = create_variant_game("xiangqi");
+      uint64_t time = 0;
+      int calls = 0;
+
+      for (int g = 0; g<10; g++) {
+         game->start_new_game();
+         game->setup_fen_position(xiangqi_perftests[n].fen);
+
+         for (int ply = 0; ply<plies; ply++) {
+            movelist_t movelist;
+            int num_quiet = 0;
+
+            game->generate_legal_moves(&movelist);
+            for (int k = 0; k<movelist.num_moves; k++)
+               if (!is_irreversible_move(movelist.move[k]))
+                  movelist.move[num_quiet++] = movelist.move[k];
+            if (num_quiet == 0) break;
+
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            game->playmove(movelist.move[state % num_quiet]);
+
+            uint64_t t = get_timer();
+            game->test_chase();
+            time += get_timer() - t;
+            calls++;
+         }
+      }
+
+      printf("%-70s %6d calls %8.2f us/call\n", xiangqi_perftests[n].fen, calls, calls ? (double)time / calls : 0.0);
+      total_time += time;
+      total_calls += calls;
+      delete game;
+      n++;
+   }
+
+   printf("Total: %d calls in %.3f s, %.2f us/call\n", total_calls, total_time / 1000000.0,
+          total_calls ? (double)total_time / total_calls : 0.0);
+}
+
+/* Print the throughput of one variant as a CSV line or a JSON object */
+static void print_throughput(const char *variant, game_t *game, const throughput_t *tp, bool json, bool first)
+{
+   if (json) {
+      printf("%s  { \"variant\": \"%s\", \"files\": %d, \"ranks\": %d, \"positions\": %d, "
+             "\"movegen\": %.0f, \"legal\": %.0f, \"makemove\": %.0f, \"copymake\": %.0f, \"see\": %.0f, \"eval\": %.0f, \"ttprobe\": %.0f }",
+             first ? "" : ",\n", variant, game->files, game->ranks, tp->positions,
+             tp->movegen, tp->legal, tp->makemove, tp->copymake, tp->see, tp->eval, tp->probe);
+   } else {
+      printf("%s,%d,%d,%d,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f\n",
+             variant, game->files, game->ranks, tp->positions,
+             tp->movegen, tp->legal, tp->makemove, tp->copymake, tp->see, tp->eval, tp->probe);
+   }
+   fflush(stdout);
+}
+
+/* Measure the throughput of the basic operations of the search for a list
+ * of variants and print it as CSV (default) or JSON, one line/object per
+ * variant. Without a list of variants, all built-in variants and all
+ * variants from variant files are measured.
+ */
+static void test_throughput(char *args)
+{
+   const char *variants[256];
+   int num_variants = 0;
+   bool json = false;
+   int msec = 100;
+
+   for (char *s = strtok(args, " \t\n"); s; s = strtok(NULL, " \t\n")) {
+      if (streq(s, "json"))
+         json = true;
+      else if (streq(s, "csv"))
+         json = false;
+      else if (isdigit(s[0]))
+         msec = atoi(s);
+      else if (num_variants < 256)
+         variants[num_variants++] = s;
+   }
+
+   if (num_variants == 0) {
+      for (int n = 0; n<num_standard_variants && num_variants < 256; n++)
+         variants[num_variants++] = standard_variants[n].name;
+      for (int n = 0; n<num_custom_variants && num_variants < 256; n++)
+         variants[num_variants++] = custom_variants[n].shortname;
+   }
+
+   if (json)
+      printf("[\n");
+   else
+      printf("variant,files,ranks,positions,movegen,legal,makemove,copymake,see,eval,ttprobe\n");
+
+   bool first = true;
+   for (int n = 0; n<num_variants; n++) {
+      game_t *game = create_variant_game(variants[n]);
+      if (!game) {
+         fprintf(stderr, "Unknown variant: %s\n", variants[n]);
+         continue;
+      }
+      game->start_new_game();
+
+      throughput_t tp;
+      game->measure_throughput(&tp, msec);
+      print_throughput(variants[n], game, &tp, json, first);
+      first = false;
+
+      delete game;
+      if (abort_search) break;
+   }
+
+   if (json)
+      printf("\n]\n");
+}
+
+static uint64_t test_benchmark(int depth, bool qsearch_hash = true, uint64_t *total_nodes = NULL)
 {
    game_t *game = NULL;
    int n = 0;
    uint64_t nodes = 0;
    uint64_t t = get_timer();
    unsigned long long int nodes_searched = 0;
+   uint64_t evals = 0;
+   uint64_t lazy_evals = 0;
+   uint64_t lazy_errors = 0;
 #ifdef TRACK_PRUNING_STATISTICS
    memset(branches_pruned_by_move, 0, sizeof branches_pruned_by_move);
 #endif
@@ -1340,6 +1528,7 @@ static uint64_t test_benchmark(int depth)
       game = create_variant_game("chess");
       game->start_new_game();
       game->random_ok = false;
+      game->qsearch_hash = qsearch_hash;
       game->output_iteration = NULL;
       game->uci_output = NULL;
       game->xboard_output = NULL;
@@ -1357,6 +1546,9 @@ static uint64_t test_benchmark(int depth)
       if (trapint) signal(SIGINT, old_signal_handler);
 #endif
       nodes_searched = game->clock.nodes_searched;
+      evals       += game->eval_count;
+      lazy_evals  += game->lazy_eval_count;
+      lazy_errors += game->lazy_eval_errors;
       delete game;
 
       if (abort_search) {
@@ -1375,7 +1567,15 @@ static uint64_t test_benchmark(int depth)
    printf("%" PRIu64 " nodes searched\n", nodes);
    printf("Elapsed time %" PRIu64 " ms\n", (tt - t) / 1000);
    printf("%g nodes / s\n", 1.0e6*nodes / (tt - t));
+   if (evals)
+      printf("Lazy evaluation: %" PRIu64 " of %" PRIu64 " evaluations (%.1f%%)\n", lazy_evals, evals, 100.0*lazy_evals / evals);
+#ifdef DEBUG_LAZY_EVAL
+   printf("Lazy evaluation errors: %" PRIu64 "\n", lazy_errors);
+#else
+   (void)lazy_errors;
+#endif
 
+   if (total_nodes) *total_nodes = nodes;
    return (tt - t);
 }
 
@@ -1386,48 +1586,56 @@ static uint64_t test_benchmark(int depth)
  */
 static void test_smp(int cores, int depth)
 {
-   game_t *game = NULL;
    int n = get_number_of_threads();
    uint64_t t_start[2];
    uint64_t t_end[2];
-   unsigned long long int moves_searched[2];
-   char *fen = "r2qkbnr/ppp2p1p/2n5/3P4/2BP1pb1/2N2p2/PPPQ2PP/R1B2RK1/ b - - 2 9";//benchtests[1].fen;
+   uint64_t nodes_searched[2];
+   const char *fen = "r2qkbnr/ppp2p1p/2n5/3P4/2BP1pb1/2N2p2/PPPQ2PP/R1B2RK1 b - - 2 9";//benchtests[1].fen;
 
-   init_threads(1);
-   game = create_variant_game("chess")
-   game->start_new_game();
-   game->random_ok = false;
-   setup_fen_position(game, fen);
-   print_board(game->board);
-   printf("Single core analysis:\n");
-   t_start[0] = get_timer();
-   computer_play(game, depth);
-   t_end[0] = get_timer();
-   moves_searched[0] = game->moves_searched;
-   end_game(game);
-
-   init_threads(cores);
-   printf("Analysis using %d cores:\n", cores);
-   game = create_variant_game("chess")
-   game->start_new_game();
-   game->random_ok = false;
-   setup_fen_position(game, fen);
-   t_start[1] = get_timer();
-   computer_play(game, depth);
-   t_end[1] = get_timer();
-   moves_searched[1] = game->moves_searched;
-   end_game(game);
+   abort_search = false;
+   for (int k = 0; k<2; k++) {
+      int threads = k ? cores : 1;
+      game_t *game = create_variant_game("chess");
+      game->start_new_game();
+      game->random_ok = false;
+      game->setup_fen_position(fen);
+      if (k == 0) game->print_board();
+
+      init_threads(threads);
+      if (threads == 1)
+         printf("Single core analysis:\n");
+      else
+         printf("Analysis using %d cores:\n", get_number_of_threads());
+
+#ifdef __unix__
+      if (trapint) old_signal_handler = signal(SIGINT, interrupt_computer);
+#endif
+      t_start[k] = get_timer();
+      game->think(depth);
+      t_end[k] = get_timer();
+#ifdef __unix__
+      if (trapint) signal(SIGINT, old_signal_handler);
+#endif
+      nodes_searched[k] = game->clock.nodes_searched;
+      delete game;
+
+      if (abort_search) break;
+   }
 
    init_threads(n);
 
+   if (abort_search) {
+      printf("\n*** Aborted\n");
+      return;
+   }
+
    printf("\n");
-   printf("Single core:     %-10"PRIu64" nodes searched\n", moves_searched[0]);
-   printf("Multi-core:      %-10"PRIu64" nodes searched\n", moves_searched[1]);
-   printf("Single core time %"PRIu64" ms\n", (t_end[0]-t_start[0]) / 1000);
-   printf("Multi-core time  %"PRIu64" ms\n", (t_end[1]-t_start[1]) / 1000);
-   printf("Relative node counts (multi/single): %.2f\n", (float)moves_searched[1] / moves_searched[0]);
+   printf("Single core:     %-10" PRIu64 " nodes searched\n", nodes_searched[0]);
+   printf("Multi-core:      %-10" PRIu64 " nodes searched\n", nodes_searched[1]);
+   printf("Single core time %" PRIu64 " ms\n", (t_end[0]-t_start[0]) / 1000);
+   printf("Multi-core time  %" PRIu64 " ms\n", (t_end[1]-t_start[1]) / 1000);
+   printf("Relative node counts (multi/single): %.2f\n", (float)nodes_searched[1] / nodes_searched[0]);
    printf("Parallel speed-up (time-to-depth):   %.2f\n", (float)(t_end[0]-t_start[0]) / (t_end[1]-t_start[1]));
-
 }
 #endif
 
@@ -1530,6 +1738,28 @@ static void run_test_suite(uint64_t time, const char *tests[])
    printf("Score: %d / %d (%d/%d correct)\n", score, 10*max_positions, position_correct, max_positions);
 }
 
+/* Report the size of the hash tables and how the memory for them was
+ * allocated.
+ */
+static void print_memory_report(game_t *game)
+{
+   if (!game) return;
+
+   hash_table_t *tt = game->transposition_table;
+   eval_hash_table_t *et = game->eval_table;
+   if (tt) {
+      printf("Transposition table: %zu entries (%zu MB), %s%s\n",
+            tt->number_of_elements, tt->memory_size >> 20,
+            large_malloc_backing_name(tt->backing), tt->interleaved ? ", interleaved" : "");
+   }
+   if (et) {
+      printf("Evaluation table:    %zu entries (%zu MB), %s%s\n",
+            et->number_of_elements, et->memory_size >> 20,
+            large_malloc_backing_name(et->backing), et->interleaved ? ", interleaved" : "");
+   }
+   printf("NUMA nodes:          %d\n", get_number_of_numa_nodes());
+}
+
 static void print_help(const char *topic)
 {
    if (!topic) topic = "help";
@@ -2100,7 +2330,9 @@ static void send_fairy_menu_to_xboard(void)
 static void send_variants_to_xboard(void)
 {
          log_xboard_output("feature setboard=1"
-//                                       " smp=1"
+#ifdef SMP
+                                       " smp=1"
+#endif
                                       " time=1"
                                     " sigint=0"
                                     " colors=0"
@@ -2402,9 +2634,7 @@ int main(int argc, char **argv)
       if (uci_dialect == 'C')
          uci_timeunit = 1000;
 
-      if (game)
-         delete game;
-      game = create_variant_game(variant_name);
+      game = replace_variant_game(game, variant_name);
       game->set_transposition_table_size(hash_size);
       game->start_new_game();
       load_evaluation_parameters(game, eval_file);
@@ -2528,9 +2758,7 @@ int main(int argc, char **argv)
             default:
                variant_name = strdup("chess");
          }
-         if (game)
-            delete game;
-         game = create_variant_game(variant_name);
+         game = replace_variant_game(game, variant_name);
          game->set_transposition_table_size(hash_size);
          game->start_new_game();
          load_evaluation_parameters(game, eval_file);
@@ -2551,6 +2779,7 @@ int main(int argc, char **argv)
 #ifdef SMP
          log_xboard_output("option%s Cores type spin default 1 min 1 max %d\n", option_name, MAX_THREADS);
 #endif
+         log_xboard_output("option%s Large Pages type check default %s\n", option_name, large_malloc_use_hugetlb ? "true" : "false");
          log_xboard_output("option%s Ponder type check default true\n", option_name);
          log_xboard_output("option%s UCI_Variant type combo default %s", option_name, variant_name);
          log_xboard_output(" var %s var chess960", standard_variants[0].name);
@@ -2611,9 +2840,7 @@ int main(int argc, char **argv)
                free((void *)variant_name);
                variant_name = strdup(s);
 
-               if (game)
-                  delete game;
-               game = create_variant_game(variant_name);
+               game = replace_variant_game(game, variant_name);
                game->set_transposition_table_size(hash_size);
                game->start_new_game();
                load_evaluation_parameters(game, eval_file);
@@ -2633,6 +2860,13 @@ int main(int argc, char **argv)
             if (strstr(s, "true") == s) uci_kxr = true;
          }
       } else if (strstr(input, "setoption name Ponder") == input && uci_mode) {
+      } else if (strstr(input, "setoption name Large Pages") == input && uci_mode) {
+         char *s = strstr(input, "value");
+         if (s) {
+            s += 6;
+            large_malloc_use_hugetlb = (strstr(s, "true") == s);
+            if (game) game->set_transposition_table_size(hash_size, true);
+         }
 #ifdef SMP
       } else if (strstr(input, "setoption name Cores") == input && uci_mode) {
          int threads = 0;
@@ -2647,9 +2881,7 @@ int main(int argc, char **argv)
          }
 #endif
       } else if ((streq(input, "ucinewgame") || streq(input, "uccinewgame") || streq(input, "usinewgame")) && uci_mode) {
-         if (game)
-            delete game;
-         game = create_variant_game(variant_name);
+         game = replace_variant_game(game, variant_name);
          game->set_transposition_table_size(hash_size);
          game->start_new_game();
          load_evaluation_parameters(game, eval_file);
@@ -2942,9 +3174,7 @@ int main(int argc, char **argv)
          eval_t       ra  = game->random_amplitude;
          size_t       rpc = game->random_ply_count;
 
-         if (game)
-            delete game;
-         game = create_variant_game(variant_name);
+         game = replace_variant_game(game, variant_name);
          if (!game) {
             log_xboard_output("Error (cannot start variant game): '%s'\n", variant_name);
          } else {
@@ -3150,6 +3380,9 @@ int main(int argc, char **argv)
             }
          }
 
+         if (strstr(input+7, "Use huge pages") || strstr(input+7, "Interleave memory")) {
+            if (game) game->set_transposition_table_size(hash_size, true);
+         }
          if (strstr(input+7, "Send O-O/O-O-O for castling")) {
             if (!castle_oo)
                log_xboard_output("telluser Warning: disabling O-O/O-O-O notation for castling breaks shuffle variants!\n");
@@ -3227,26 +3460,52 @@ int main(int argc, char **argv)
                      printf("Current skill level '%s'\n", combo_skill[n].label);
                }
             }
+      } else if (strstr(input, "sliders") == input) {
+         char *s = input + 7;
+         while (*s && isspace(*s)) s++;
+         if (*s) {
+            slider_backend_t backend = SLIDER_AUTO;
+            bool found = false;
+            for (int n = SLIDER_AUTO; n <= SLIDER_PEXT; n++) {
+               if (streq(s, slider_backend_name((slider_backend_t)n))) {
+                  backend = (slider_backend_t)n;
+                  found = true;
+               }
+            }
+            if (found) {
+               slider_backend = backend;
+               if (game) game->set_slider_backend(backend);
+            } else {
+               printf("Unknown slider backend '%s'\n", s);
+            }
+         }
+         printf("Slider attacks: %s", slider_backend_name(slider_backend));
+         if (game) printf(" (%s in use)", slider_backend_name(game->get_slider_backend()));
+         printf("\n");
       } else if (strstr(input, "memory") == input) {
-         unsigned long int memory_size;
-         sscanf(input+7, "%lu", &memory_size);
-
-         /* Convert to bytes */
-         memory_size <<= 20;
-
-         size_t nelem = memory_size / sizeof(hash_table_entry_t);
-         /* Round to the next-lowest power of 2 */
-         nelem |= (nelem >> 1);
-         nelem |= (nelem >> 2);
-         nelem |= (nelem >> 4);
-         nelem |= (nelem >> 8);
-         nelem |= (nelem >> 16);
-         nelem |= (nelem >> 32*(sizeof(size_t)>4));
-         nelem >>= 1;
-         nelem++;
-
-         hash_size = nelem;
-         game->set_transposition_table_size(hash_size);
+         unsigned long int memory_size = 0;
+         char *s = input + 6;
+         while (*s && isspace(*s)) s++;
+         if (sscanf(s, "%lu", &memory_size) != 1) {
+            print_memory_report(game);
+         } else {
+            /* Convert to bytes */
+            memory_size <<= 20;
+
+            size_t nelem = memory_size / sizeof(hash_table_entry_t);
+            /* Round to the next-lowest power of 2 */
+            nelem |= (nelem >> 1);
+            nelem |= (nelem >> 2);
+            nelem |= (nelem >> 4);
+            nelem |= (nelem >> 8);
+            nelem |= (nelem >> 16);
+            nelem |= (nelem >> 32*(sizeof(size_t)>4));
+            nelem >>= 1;
+            nelem++;
+
+            hash_size = nelem;
+            game->set_transposition_table_size(hash_size);
+         }
       } else if (strstr(input, "analyze") || strstr(input, "analyse")) {
          if (game) {
             in_play = false;
@@ -3294,8 +3553,14 @@ int main(int argc, char **argv)
          if (game) {
             int depth = 6;
             int root = 0;
+            bool divide = false;
             char *s = input + 5;
             while (*s && isspace(*s)) s++;
+            if (strstr(s, "divide") == s) {
+               divide = true;
+               s += 6;
+               while (*s && isspace(*s)) s++;
+            }
             if (*s) {
                sscanf(s, "%d", &depth);
                while(*s && isdigit(*s)) s++;
@@ -3308,9 +3573,20 @@ int main(int argc, char **argv)
             if (trapint) old_signal_handler = signal(SIGINT, interrupt_computer);
 #endif
             abort_search = false;
+            game->clear_perft_table();
             uint64_t t = get_timer();
+            if (divide) {
+               /* Only the requested depth, with a sub-total for each move */
+               uint64_t nodes = game->perft(depth, root ? root : 1);
+               uint64_t tt = get_timer();
+               if (tt == t) tt++;
+               if (!abort_search)
+                  printf("%2d %10lld %5.2f %12.2fnps\n", depth, (long long int)nodes,
+                        (double)((tt - t)/1000000.0), (double)(nodes*1.0e6/(tt-t)));
+               depth = 0;
+            }
             for (int n = 1; n<depth+1; n++) {
-               uint64_t nodes = perft(game, n, root);
+               uint64_t nodes = game->perft(n, root);
                uint64_t tt = get_timer();
 
                if (tt == t) tt++;
@@ -3343,9 +3619,10 @@ int main(int argc, char **argv)
             if (trapint) old_signal_handler = signal(SIGINT, interrupt_computer);
 #endif
             abort_search = false;
+            game->clear_perft_table();
             uint64_t t = get_timer();
             for (int n = 1; n<depth+1; n++) {
-               uint64_t nodes = perft(game, n, root, true);
+               uint64_t nodes = game->perft(n, root, true);
                uint64_t tt = get_timer();
 
                if (tt == t) tt++;
@@ -3360,17 +3637,35 @@ int main(int argc, char **argv)
             if (trapint) signal(SIGINT, old_signal_handler);
 #endif
          }
+      } else if (strstr(input, "test sliders") == input) {
+         test_sliders();
       } else if (strstr(input, "test movegen") == input) {
          test_movegen();
       } else if (strstr(input, "test legal movegen") == input) {
          test_movegen(true);
+      } else if (strstr(input, "test throughput") == input) {
+         test_throughput(input + 15);
       } else if (strstr(input, "test benchmark") == input) {
          int depth = 10;
          char *s = input + 15;
          while (*s && isspace(*s)) s++;
          if (*s) sscanf(s, "%d", &depth);
          //printf("Benchmark %d\n", depth);
-         test_benchmark(depth);
+         if (strstr(s, "qs")) {
+            /* Measure the effect of the transposition table in QS */
+            uint64_t n1, n2;
+            printf("Benchmark %d, no transposition table in QS\n", depth);
+            uint64_t t1 = test_benchmark(depth, false, &n1);
+            if (!abort_search) {
+               printf("Benchmark %d, transposition table in QS\n", depth);
+               uint64_t t2 = test_benchmark(depth, true, &n2);
+               if (!abort_search && n1 && t1)
+                  printf("QS hashing: %+.1f%% nodes, %+.1f%% time to depth\n",
+                        100.0 * ((double)n2 - n1) / n1, 100.0 * ((double)t2 - t1) / t1);
+            }
+         } else {
+            test_benchmark(depth);
+         }
       } else if (strstr(input, "test ebf") == input) {
          int depth = 10;
          char *s = input + 8;
@@ -3413,8 +3708,13 @@ int main(int argc, char **argv)
          } else {
             if (*s) sscanf(s, "%d %d", &cores, &depth);
          }
+         if (cores < 2) cores = 2;
          test_smp(cores, depth);
 #endif
+      } else if (strstr(input, "test chase bench") == input) {
+         int plies = 100;
+         sscanf(input+16, "%d", &plies);
+         test_chase_benchmark(plies);
       } else if (strstr(input, "test chase") == input) {
          chase_state_t state = game->test_chase();
          switch (state) {